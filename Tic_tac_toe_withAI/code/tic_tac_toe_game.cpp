@@ -25,6 +25,29 @@ Controls:
 - Input your move using cell coordinates (e.g., A1, B3, 3C)
 - The game automatically alternates turns
 - Restart by rerunning the program
+- Bigger boards: --size 4 --k 4, --size 5 --k 4, ... (see main)
+- Move server: --server PORT answers board queries over TCP
+  (see "Move server")
+- Position databases: --solve FILE --size 4 --k 4 solves the openings
+  of a bigger board offline; --db FILE then plays them without a search
+  (see "Position database")
+
+Building:
+---------
+- With the top-level CMake build (cmake -S . -B build), which also builds
+  the shared runtime library it uses (thread pool, arenas, tracing,
+  histograms); or
+  g++ -std=c++17 -O2 -I../../runtime/include tic_tac_toe_game.cpp
+  ../../runtime/src/arena.cpp ../../runtime/src/thread_pool.cpp
+  ../../runtime/src/trace.cpp -pthread
+- --trace FILE records the search, self-play and server threads and
+  writes a Chrome trace (open it in chrome://tracing or ui.perfetto.dev)
+
+Build options:
+--------------
+- -DTTT_OPENING_BOOK: the hard AI reads its moves from a table that the
+  compiler solves at build time (no search at runtime); the CMake option
+  of the same name sets it
 
 Author: Vaggelis Papaioannou
 
@@ -34,12 +57,192 @@ Author: Vaggelis Papaioannou
 #include <cstdlib>
 #include <ctime>
 #include <limits>
+#include <cstdint>
+#include <bitset>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <iomanip>
+#include <sstream>
+#include <csignal>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <unordered_set>
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+#include "runtime/arena.h"
+#include "runtime/histogram.h"
+#include "runtime/thread_pool.h"
+#include "runtime/trace.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TTT_HAVE_MMAP 1
+#endif
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#endif
 using namespace std;
 
 const int SIZE = 3;
+const int CELLS = SIZE * SIZE;
 const char PLAYER = 'X';
 const char AI = 'O';
 
+// ===================================================
+// Struct  : Bitboard
+// Purpose : Compact game state used by the AI logic
+// Fields  :
+//   - player: 9-bit mask of the cells taken by 'X'
+//   - ai    : 9-bit mask of the cells taken by 'O'
+// Notes   : Cell (r, c) is stored in bit r * SIZE + c.
+//           The char board is only kept for printing and input.
+// ===================================================
+struct Bitboard {
+    uint16_t player = 0;
+    uint16_t ai = 0;
+};
+
+constexpr uint16_t FULL_MASK = (1 << CELLS) - 1;
+
+// The 8 winning lines as bit masks (bit r * SIZE + c per cell)
+constexpr uint16_t WIN_LINES[8] = {
+    0x007, 0x038, 0x1C0,  // Rows A, B, C
+    0x049, 0x092, 0x124,  // Columns 1, 2, 3
+    0x111, 0x054          // Main diagonal, anti-diagonal
+};
+
+// Returns the bit of cell (r, c)
+inline uint16_t cellBit(int r, int c) {
+    return uint16_t(1u << (r * SIZE + c));
+}
+
+// Returns the mask of all occupied cells
+inline uint16_t occupied(const Bitboard& state) {
+    return state.player | state.ai;
+}
+
+// Returns the mask that belongs to the given symbol ('X' or 'O')
+inline uint16_t& maskOf(Bitboard& state, char symbol) {
+    return symbol == AI ? state.ai : state.player;
+}
+
+// ===================================================
+// Function: toBitboard
+// Purpose : Builds the bitboard state from a char board
+// Input   : A 2D character array 'board' representing the grid
+// Returns : The matching Bitboard
+// ===================================================
+Bitboard toBitboard(char board[SIZE][SIZE]) {
+    Bitboard state;
+    for (int r = 0; r < SIZE; r++)
+        for (int c = 0; c < SIZE; c++) {
+            if (board[r][c] == PLAYER) state.player |= cellBit(r, c);
+            else if (board[r][c] == AI) state.ai |= cellBit(r, c);
+        }
+    return state;
+}
+
+// ===================================================
+// Function: toCharBoard
+// Purpose : Writes the bitboard state into a char board
+// Input   :
+//   - state: the bitboard to copy from
+//   - board: the 2D character array to fill (' ', 'X' or 'O')
+// ===================================================
+void toCharBoard(const Bitboard& state, char board[SIZE][SIZE]) {
+    for (int r = 0; r < SIZE; r++)
+        for (int c = 0; c < SIZE; c++) {
+            uint16_t bit = cellBit(r, c);
+            board[r][c] = (state.player & bit) ? PLAYER : (state.ai & bit) ? AI : ' ';
+        }
+}
+
+// Returns true if 'mask' contains a complete winning line
+constexpr bool hasLine(uint16_t mask) {
+    for (uint16_t line : WIN_LINES)
+        if ((mask & line) == line)
+            return true;
+    return false;
+}
+
+// Returns the number of set bits in 'mask'
+inline int popCount(uint64_t mask) {
+    return int(bitset<64>(mask).count());
+}
+
+// Returns the index of the n-th (0-based) set bit of 'mask'
+inline int nthSetBit(uint64_t mask, int n) {
+#if defined(__BMI2__)
+    uint64_t bit = _pdep_u64(uint64_t(1) << n, mask);
+#else
+    for (int i = 0; i < n; i++) mask &= mask - 1;  // Drop the lowest n bits
+    uint64_t bit = mask & (~mask + 1);
+#endif
+    return popCount(bit - 1);
+}
+
+// ===================================================
+// Class   : Pcg32
+// Purpose : Small and fast random number generator (PCG-XSH-RR)
+// Notes   :
+//   - Each thread owns one (see 'rng'), so threads never wait on a
+//     shared generator as they do with rand()
+//   - The same seed and stream always give the same numbers, which
+//     makes games and self-play runs reproducible
+// ===================================================
+class Pcg32 {
+public:
+    void seed(uint64_t seedValue, uint64_t stream = 0) {
+        state = 0;
+        inc = (stream << 1) | 1;
+        next();
+        state += seedValue;
+        next();
+    }
+
+    uint32_t next() {
+        uint64_t old = state;
+        state = old * 6364136223846793005ull + inc;
+        uint32_t xorShifted = uint32_t(((old >> 18) ^ old) >> 27);
+        uint32_t rot = uint32_t(old >> 59);
+        return (xorShifted >> rot) | (xorShifted << ((32 - rot) & 31));
+    }
+
+    // Uniform number in 0..n-1 (multiply-shift, with rejection against bias)
+    uint32_t below(uint32_t n) {
+        uint64_t m = uint64_t(next()) * n;
+        if (uint32_t(m) < n) {
+            uint32_t threshold = (0u - n) % n;
+            while (uint32_t(m) < threshold) m = uint64_t(next()) * n;
+        }
+        return uint32_t(m >> 32);
+    }
+
+private:
+    uint64_t state = 0x853C49E6748FEA9Bull;
+    uint64_t inc = 0xDA3E39CB94B95BDBull;
+};
+
+// Random number generator of the current thread
+thread_local Pcg32 rng;
+
 // ===================================================
 // Function: printBoard
 // Purpose : Displays the current state of the 3x3 game board
@@ -60,86 +263,128 @@ void printBoard(char board[SIZE][SIZE]) {
     cout << "\n";
 }
 
+// Per-line counters: line l (index into WIN_LINES) is kept in bits
+// 4l..4l+3 of a 32-bit word, so one addition updates every line
+// through a cell
+constexpr uint32_t lineIncrement(int cell) {
+    uint32_t inc = 0;
+    for (int line = 0; line < 8; line++)
+        if (WIN_LINES[line] & (1 << cell))
+            inc += 1u << (4 * line);
+    return inc;
+}
+
+constexpr uint32_t LINE_INCREMENT[CELLS] = {
+    lineIncrement(0), lineIncrement(1), lineIncrement(2),
+    lineIncrement(3), lineIncrement(4), lineIncrement(5),
+    lineIncrement(6), lineIncrement(7), lineIncrement(8)
+};
+
+// Returns the top bit of every 4-bit counter of x that is zero
+constexpr uint32_t zeroCounters(uint32_t x) {
+    return ~(((x & 0x77777777u) + 0x77777777u) | x) & 0x88888888u;
+}
+
 // ===================================================
-// Function: checkWinner
-// Purpose : Checks if there is a winner on the board
-// Input   : A 2D character array 'board' representing the grid
-// Returns :
-//   - 'X' if the player has won
-//   - 'O' if the AI has won
-//   - ' ' (space) if there is no winner yet
-// Logic   : Checks all rows, columns, and both diagonals for matching symbols
+// Class   : GameState
+// Purpose : Bitboard with incremental make/unmake and threat tracking
+// Notes   :
+//   - Keeps the number of symbols of each side on each of the 8 lines,
+//     updated with one addition per move (see LINE_INCREMENT)
+//   - A "threat" is a line with two of one side's symbols and none of
+//     the other's. All counters are compared at once, so "can X win
+//     next move" and "where must O block" are O(1) queries.
+//   - Sides are indexed 0 = Player ('X'), 1 = AI ('O')
 // ===================================================
-char checkWinner(char board[SIZE][SIZE]) {
-    // Check rows
-    for (int r = 0; r < SIZE; r++)
-        if (board[r][0] != ' ' && board[r][0] == board[r][1] && board[r][1] == board[r][2])
-            return board[r][0];
+class GameState {
+public:
+    GameState() = default;
 
-    // Check columns
-    for (int c = 0; c < SIZE; c++)
-        if (board[0][c] != ' ' && board[0][c] == board[1][c] && board[1][c] == board[2][c])
-            return board[0][c];
+    explicit GameState(const Bitboard& start) {
+        for (int cell = 0; cell < CELLS; cell++) {
+            if (start.player & (1 << cell)) makeMove(cell, PLAYER);
+            else if (start.ai & (1 << cell)) makeMove(cell, AI);
+        }
+    }
 
-    // Check main diagonal
-    if (board[0][0] != ' ' && board[0][0] == board[1][1] && board[1][1] == board[2][2])
-        return board[0][0];
+    const Bitboard& board() const { return bits; }
 
-    // Check anti-diagonal
-    if (board[0][2] != ' ' && board[0][2] == board[1][1] && board[1][1] == board[2][0])
-        return board[0][2];
+    void makeMove(int cell, char symbol) {
+        int side = sideOf(symbol);
+        (side ? bits.ai : bits.player) |= uint16_t(1u << cell);
+        lineCounts[side] += LINE_INCREMENT[cell];
+    }
 
-    return ' ';  // No winner found
-}
+    void unmakeMove(int cell, char symbol) {
+        int side = sideOf(symbol);
+        (side ? bits.ai : bits.player) &= ~uint16_t(1u << cell);
+        lineCounts[side] -= LINE_INCREMENT[cell];
+    }
 
-// ===================================================
-// Function: isDraw
-// Purpose : Determines if the game has ended in a draw
-// Input   : A 2D character array 'board' representing the grid
-// Returns :
-//   - true  → if all cells are filled and there is no winner
-//   - false → if at least one cell is empty
-// Logic   : Scans the entire board for any empty cell (' ')
-// ===================================================
-bool isDraw(char board[SIZE][SIZE]) {
-    for (int r = 0; r < SIZE; r++)
-        for (int c = 0; c < SIZE; c++)
-            if (board[r][c] == ' ')
-                return false;
-    return true;
+    // 'X' if the player has a full line, 'O' if the AI has one, else ' '
+    char winner() const {
+        if (zeroCounters(lineCounts[0] ^ 0x33333333u)) return PLAYER;
+        if (zeroCounters(lineCounts[1] ^ 0x33333333u)) return AI;
+        return ' ';
+    }
+
+    bool isFull() const { return occupied(bits) == FULL_MASK; }
+
+    bool canWinNextMove(char symbol) const { return threatLines(sideOf(symbol)) != 0; }
+
+    // Empty cells where 'symbol' would complete a line
+    uint16_t winningCells(char symbol) const {
+        uint16_t cells = 0;
+        for (uint32_t lines = threatLines(sideOf(symbol)); lines; lines &= lines - 1)
+            cells |= WIN_LINES[popCount((lines & (~lines + 1)) - 1) / 4];
+        return cells & ~occupied(bits);
+    }
+
+    // Exchanges the two sides, so the AI functions can move for 'X'
+    void swapSides() {
+        swap(bits.player, bits.ai);
+        swap(lineCounts[0], lineCounts[1]);
+    }
+
+private:
+    static int sideOf(char symbol) { return symbol == AI ? 1 : 0; }
+
+    // Top bit of each line's counter where 'side' has 2 symbols and the other side none
+    uint32_t threatLines(int side) const {
+        return zeroCounters(lineCounts[side] ^ 0x22222222u) & zeroCounters(lineCounts[1 - side]);
+    }
+
+    Bitboard bits;
+    uint32_t lineCounts[2] = {};  // 4-bit symbol count per line, per side
+};
+
+// Returns the lowest cell in 'mask' (mask must not be empty)
+inline int lowestCell(uint16_t mask) {
+    return popCount(uint16_t(mask & (~mask + 1)) - 1);
 }
 
+
 // ===================================================
 // Function: tryWinningMove
 // Purpose : Checks if the given player (symbol) can win in one move
 // Input   :
-//   - board : 3x3 game board
+//   - game  : incremental game state
 //   - symbol: the player symbol to check ('X' or 'O')
 // Output   :
 //   - r, c  : the row and column of the winning move (via reference)
 // Returns  :
 //   - true  → if a winning move is found and (r, c) are set
 //   - false → if no winning move is available
-// Logic    : Tries placing 'symbol' in every empty cell temporarily,
-//            checks if it results in a win using checkWinner(),
-//            and undoes the move afterward.
-// ===================================================
-bool tryWinningMove(char board[SIZE][SIZE], int &r, int &c, char symbol) {
-    for (int i = 0; i < SIZE; i++) {
-        for (int j = 0; j < SIZE; j++) {
-            if (board[i][j] == ' ') {
-                board[i][j] = symbol;  // Try move
-                if (checkWinner(board) == symbol) {
-                    r = i;
-                    c = j;
-                    board[i][j] = ' '; // Undo move
-                    return true;
-                }
-                board[i][j] = ' '; // Undo move
-            }
-        }
-    }
-    return false;
+// Logic    : Reads the threat mask kept by GameState (O(1)). If there
+//            are several winning cells, the first one (A1, A2, ...) is used.
+// ===================================================
+bool tryWinningMove(const GameState& game, int &r, int &c, char symbol) {
+    uint16_t cells = game.winningCells(symbol);
+    if (!cells) return false;
+    int cell = lowestCell(cells);
+    r = cell / SIZE;
+    c = cell % SIZE;
+    return true;
 }
 
 
@@ -186,41 +431,38 @@ int chooseDifficulty() {
 // ===================================================
 // Function: makeEasyAIMove
 // Purpose : Executes an "easy" AI move by randomly selecting an empty cell
-// Input   : The current state of the game board (3x3)
+// Input   : The incremental game state
 // Behavior: 
-//   - Picks a random cell (row, column)
-//   - Repeats until it finds an empty cell (' ')
+//   - Counts the empty cells and draws one of them uniformly
+//     with this thread's generator (no retries)
 //   - Places the AI symbol ('O') in that cell
 // Notes   : This strategy is purely random and not strategic
 // ===================================================
-void makeEasyAIMove(char board[SIZE][SIZE]) {
-    int r, c;
-    do {
-        r = rand() % SIZE;
-        c = rand() % SIZE;
-    } while (board[r][c] != ' ');
-    board[r][c] = AI;
+void makeEasyAIMove(GameState& game) {
+    uint16_t empty = FULL_MASK & ~occupied(game.board());
+    int cell = nthSetBit(empty, int(rng.below(uint32_t(popCount(empty)))));
+    game.makeMove(cell, AI);
 }
 
 
 // ===================================================
 // Function: makeMediumAIMove
 // Purpose : Executes a "medium" difficulty AI move
-// Input   : The current state of the game board (3x3)
+// Input   : The incremental game state
 // Behavior:
 //   1. If AI can win in one move, it makes that move
 //   2. Else if the player can win next move, AI blocks it
 //   3. Else it falls back to a random move (easy mode)
 // Notes   : Introduces basic defensive strategy to the AI
 // ===================================================
-void makeMediumAIMove(char board[SIZE][SIZE]) {
+void makeMediumAIMove(GameState& game) {
     int r, c;
-    if (tryWinningMove(board, r, c, AI)) {
-        board[r][c] = AI;  // Take winning move
-    } else if (tryWinningMove(board, r, c, PLAYER)) {
-        board[r][c] = AI;  // Block player's winning move
+    if (tryWinningMove(game, r, c, AI)) {
+        game.makeMove(r * SIZE + c, AI);  // Take winning move
+    } else if (tryWinningMove(game, r, c, PLAYER)) {
+        game.makeMove(r * SIZE + c, AI);  // Block player's winning move
     } else {
-        makeEasyAIMove(board);  // Random move
+        makeEasyAIMove(game);  // Random move
     }
 }
 
@@ -228,26 +470,30 @@ void makeMediumAIMove(char board[SIZE][SIZE]) {
 // ===================================================
 // Function: evaluate
 // Purpose : Assigns a numeric score to the current board state
-// Input   : The current game board
+// Input   : The incremental game state
 // Returns :
 //   +10 if AI ('O') has won
 //   -10 if Player ('X') has won
 //     0 if the game is still ongoing or a draw
 // Used by: minimax() to evaluate terminal states
 // ===================================================
-int evaluate(char board[SIZE][SIZE]) {
-    char winner = checkWinner(board);
+int evaluate(const GameState& game) {
+    char winner = game.winner();
     if (winner == AI) return +10;
     if (winner == PLAYER) return -10;
     return 0;
 }
 
 
+// Positions visited by minimax() and alphaBeta() on this thread
+thread_local uint64_t searchNodes = 0;
+
+
 // ===================================================
 // Function: minimax
 // Purpose : Implements the Minimax algorithm recursively
 // Input   :
-//   - board: current game board
+//   - game: incremental game state (restored before returning)
 //   - isMaximizing: true if it's AI's turn, false for Player
 // Returns :
 //   - Best score possible for the current player
@@ -256,32 +502,30 @@ int evaluate(char board[SIZE][SIZE]) {
 //   - If AI's turn: maximize the score
 //   - If Player's turn: minimize the score
 // ===================================================
-int minimax(char board[SIZE][SIZE], bool isMaximizing) {
-    int score = evaluate(board);
-    if (score == 10 || score == -10 || isDraw(board))
+int minimax(GameState& game, bool isMaximizing) {
+    searchNodes++;
+    int score = evaluate(game);
+    if (score == 10 || score == -10 || game.isFull())
         return score;
 
+    uint16_t taken = occupied(game.board());
     if (isMaximizing) {
         int best = -1000;
-        for (int r = 0; r < SIZE; r++) {
-            for (int c = 0; c < SIZE; c++) {
-                if (board[r][c] == ' ') {
-                    board[r][c] = AI;
-                    best = max(best, minimax(board, false));
-                    board[r][c] = ' ';
-                }
+        for (int cell = 0; cell < CELLS; cell++) {
+            if (!(taken & (1 << cell))) {
+                game.makeMove(cell, AI);
+                best = max(best, minimax(game, false));
+                game.unmakeMove(cell, AI);
             }
         }
         return best;
     } else {
         int best = 1000;
-        for (int r = 0; r < SIZE; r++) {
-            for (int c = 0; c < SIZE; c++) {
-                if (board[r][c] == ' ') {
-                    board[r][c] = PLAYER;
-                    best = min(best, minimax(board, true));
-                    board[r][c] = ' ';
-                }
+        for (int cell = 0; cell < CELLS; cell++) {
+            if (!(taken & (1 << cell))) {
+                game.makeMove(cell, PLAYER);
+                best = min(best, minimax(game, true));
+                game.unmakeMove(cell, PLAYER);
             }
         }
         return best;
@@ -289,56 +533,448 @@ int minimax(char board[SIZE][SIZE], bool isMaximizing) {
 }
 
 
+// Cell permutations for the 8 symmetries of the board.
+// After symmetry s, cell i holds what was in cell SYMMETRIES[s][i].
+constexpr int SYMMETRIES[8][CELLS] = {
+    { 0, 1, 2, 3, 4, 5, 6, 7, 8 },  // Identity
+    { 6, 3, 0, 7, 4, 1, 8, 5, 2 },  // Rotate 90°
+    { 8, 7, 6, 5, 4, 3, 2, 1, 0 },  // Rotate 180°
+    { 2, 5, 8, 1, 4, 7, 0, 3, 6 },  // Rotate 270°
+    { 2, 1, 0, 5, 4, 3, 8, 7, 6 },  // Mirror left-right
+    { 6, 7, 8, 3, 4, 5, 0, 1, 2 },  // Mirror top-bottom
+    { 0, 3, 6, 1, 4, 7, 2, 5, 8 },  // Flip on main diagonal
+    { 8, 5, 2, 7, 4, 1, 6, 3, 0 }   // Flip on anti-diagonal
+};
+
+// Every 9-bit mask under every symmetry, so a board is transformed
+// with two table lookups instead of nine bit moves
+struct SymmetryTable {
+    uint16_t map[8][1 << CELLS];
+};
+
+constexpr SymmetryTable buildSymmetryTable() {
+    SymmetryTable table{};
+    for (int s = 0; s < 8; s++)
+        for (int mask = 0; mask < (1 << CELLS); mask++) {
+            uint16_t out = 0;
+            for (int i = 0; i < CELLS; i++)
+                if (mask & (1 << SYMMETRIES[s][i]))
+                    out |= uint16_t(1u << i);
+            table.map[s][mask] = out;
+        }
+    return table;
+}
+
+constexpr SymmetryTable SYMMETRY_TABLE = buildSymmetryTable();
+
+// ===================================================
+// Function: canonicalKey
+// Purpose : Builds the transposition table key of a position
+// Input   :
+//   - state: bitboard state of the game
+//   - isMaximizing: true if it's AI's turn, false for Player
+// Returns : A 19-bit key: the smallest (player << 9 | ai) value over the
+//           8 symmetries, plus the side to move in bit 18
+// Notes   : Rotated or mirrored positions get the same key, since they
+//           have the same minimax score.
+// ===================================================
+uint32_t canonicalKey(const Bitboard& state, bool isMaximizing) {
+    uint32_t best = ~0u;
+    for (int s = 0; s < 8; s++) {
+        uint32_t key = (uint32_t(SYMMETRY_TABLE.map[s][state.player]) << CELLS)
+                     | SYMMETRY_TABLE.map[s][state.ai];
+        if (key < best) best = key;
+    }
+    return best | (uint32_t(isMaximizing) << (2 * CELLS));
+}
+
+// What a stored score means relative to the true minimax score
+enum class Bound : uint8_t {
+    None,   // Empty slot
+    Exact,  // Score is the true minimax score
+    Lower,  // True score is >= score (search was cut off high)
+    Upper   // True score is <= score (every move failed low)
+};
+
+struct TTEntry {
+    int8_t score = 0;
+    Bound bound = Bound::None;
+};
+
+// ===================================================
+// Class   : TranspositionTable
+// Purpose : Remembers search results for positions already seen
+// Notes   :
+//   - Indexed directly by canonicalKey(), so a lookup is one array
+//     access and entries never collide (2^19 slots, 1 MB)
+//   - Scores do not depend on the path or search depth, so entries
+//     stay valid for the rest of the game and for later games
+// ===================================================
+class TranspositionTable {
+public:
+    TranspositionTable() : entries(size_t(1) << (2 * CELLS + 1)) {}
+
+    // Returns true and fills 'entry' if the key has been stored
+    bool probe(uint32_t key, TTEntry& entry) const {
+        entry = entries[key];
+        return entry.bound != Bound::None;
+    }
+
+    void store(uint32_t key, int score, Bound bound) {
+        entries[key].score = int8_t(score);
+        entries[key].bound = bound;
+    }
+
+    void clear() {
+        fill(entries.begin(), entries.end(), TTEntry());
+    }
+
+private:
+    vector<TTEntry> entries;
+};
+
+
+#ifdef TTT_OPENING_BOOK
+// ===================================================
+// Opening book (build with -DTTT_OPENING_BOOK)
+// ---------------------------------------------------
+// The whole game is solved by the compiler. The result is a sorted
+// table of every position where the AI is to move, up to symmetry,
+// with its score and the set of optimal moves. makeHardAIMove() then
+// answers with a lookup instead of a search, and there are no tables
+// to warm up at startup.
+// MSVC needs a higher constexpr step limit, e.g. /constexpr:steps10000000.
+// ===================================================
+
+constexpr int BOARD_CODES = 19683;  // 3^9 possible boards
+constexpr int8_t UNSOLVED = 127;
+
+// Base-3 code of a position: digit i is 0 (empty), 1 ('X') or 2 ('O')
+constexpr int boardCode(uint16_t player, uint16_t ai) {
+    int code = 0, digit = 1;
+    for (int i = 0; i < CELLS; i++, digit *= 3) {
+        if (player & (1 << i)) code += digit;
+        else if (ai & (1 << i)) code += 2 * digit;
+    }
+    return code;
+}
+
+// Finds the symmetry that canonicalKey() would pick for this position
+constexpr int canonicalSymmetry(uint16_t player, uint16_t ai) {
+    int bestSym = 0;
+    uint32_t bestKey = ~0u;
+    for (int s = 0; s < 8; s++) {
+        uint32_t key = (uint32_t(SYMMETRY_TABLE.map[s][player]) << CELLS)
+                     | SYMMETRY_TABLE.map[s][ai];
+        if (key < bestKey) {
+            bestKey = key;
+            bestSym = s;
+        }
+    }
+    return bestSym;
+}
+
+// Scratch space of the compile-time solver
+struct BookSolution {
+    int8_t score[2][BOARD_CODES];    // [aiToMove][code], UNSOLVED if not reached
+    uint16_t bestMoves[BOARD_CODES]; // Optimal cells when the AI is to move
+};
+
+// Plain minimax over every position, memoized by board code
+constexpr int solveForBook(BookSolution& solution, uint16_t player, uint16_t ai,
+                           bool aiToMove) {
+    if (hasLine(ai)) return 10;
+    if (hasLine(player)) return -10;
+    if ((player | ai) == FULL_MASK) return 0;
+
+    int code = boardCode(player, ai);
+    if (solution.score[aiToMove][code] != UNSOLVED)
+        return solution.score[aiToMove][code];
+
+    int best = aiToMove ? -1000 : 1000;
+    uint16_t moves = 0;
+    for (int cell = 0; cell < CELLS; cell++) {
+        uint16_t bit = uint16_t(1u << cell);
+        if ((player | ai) & bit) continue;
+        if (aiToMove) {
+            int score = solveForBook(solution, player, ai | bit, false);
+            if (score > best) { best = score; moves = bit; }
+            else if (score == best) moves |= bit;
+        } else {
+            best = min(best, solveForBook(solution, player | bit, ai, true));
+        }
+    }
+
+    solution.score[aiToMove][code] = int8_t(best);
+    if (aiToMove) solution.bestMoves[code] = moves;
+    return best;
+}
+
+constexpr BookSolution solveAllPositions() {
+    BookSolution solution{};
+    for (int code = 0; code < BOARD_CODES; code++)
+        solution.score[0][code] = solution.score[1][code] = UNSOLVED;
+    solveForBook(solution, 0, 0, true);   // AI moves first
+    solveForBook(solution, 0, 0, false);  // Player moves first
+    return solution;
+}
+
+constexpr BookSolution BOOK_SOLUTION = solveAllPositions();
+
+// Inverse of boardCode()
+constexpr Bitboard boardFromCode(int code) {
+    Bitboard state;
+    for (int i = 0; i < CELLS; i++, code /= 3) {
+        if (code % 3 == 1) state.player |= uint16_t(1u << i);
+        else if (code % 3 == 2) state.ai |= uint16_t(1u << i);
+    }
+    return state;
+}
+
+// True if the AI has to move in 'code' and the board is in canonical orientation
+constexpr bool isBookPosition(int code) {
+    if (BOOK_SOLUTION.score[1][code] == UNSOLVED) return false;
+    Bitboard state = boardFromCode(code);
+    int sym = canonicalSymmetry(state.player, state.ai);
+    return SYMMETRY_TABLE.map[sym][state.player] == state.player
+        && SYMMETRY_TABLE.map[sym][state.ai] == state.ai;
+}
+
+constexpr int countBookPositions() {
+    int count = 0;
+    for (int code = 0; code < BOARD_CODES; code++)
+        if (isBookPosition(code)) count++;
+    return count;
+}
+
+constexpr int BOOK_SIZE = countBookPositions();
+
+struct BookEntry {
+    uint16_t code;       // boardCode() of the canonical position
+    uint16_t bestMoves;  // Optimal cells, in the canonical orientation
+    int8_t score;        // +10 / 0 / -10, as returned by minimax()
+};
+
+struct OpeningBook {
+    BookEntry entries[BOOK_SIZE];
+};
+
+constexpr OpeningBook buildOpeningBook() {
+    OpeningBook book{};
+    int n = 0;
+    for (int code = 0; code < BOARD_CODES; code++)  // Increasing code, so sorted
+        if (isBookPosition(code))
+            book.entries[n++] = { uint16_t(code), BOOK_SOLUTION.bestMoves[code],
+                                  BOOK_SOLUTION.score[1][code] };
+    return book;
+}
+
+constexpr OpeningBook OPENING_BOOK = buildOpeningBook();
+
+// ===================================================
+// Function: lookupOpeningBook
+// Purpose : Finds the AI's move in the compile-time opening book
+// Input   : state - bitboard state with the AI to move
+// Output  : cell  - the first optimal cell in index order (via reference),
+//                   the same move the search would pick
+//           score - the minimax score of the position (via reference)
+// Returns : false if the position is not in the book
+// ===================================================
+bool lookupOpeningBook(const Bitboard& state, int& cell, int& score) {
+    int sym = canonicalSymmetry(state.player, state.ai);
+    uint16_t code = uint16_t(boardCode(SYMMETRY_TABLE.map[sym][state.player],
+                                       SYMMETRY_TABLE.map[sym][state.ai]));
+
+    const BookEntry* begin = OPENING_BOOK.entries;
+    const BookEntry* end = begin + BOOK_SIZE;
+    const BookEntry* entry = lower_bound(begin, end, code,
+        [](const BookEntry& e, uint16_t c) { return e.code < c; });
+    if (entry == end || entry->code != code) return false;
+
+    // Canonical cell i is cell SYMMETRIES[sym][i] of the real board
+    uint16_t moves = 0;
+    for (int i = 0; i < CELLS; i++)
+        if (entry->bestMoves & (1 << i))
+            moves |= uint16_t(1u << SYMMETRIES[sym][i]);
+
+    for (cell = 0; !(moves & (1 << cell)); cell++) {}
+    score = entry->score;
+    return true;
+}
+#endif
+
+
+// Search modes available to makeHardAIMove()
+enum class SearchMode {
+    Minimax,     // Full minimax tree (reference implementation)
+    AlphaBeta,   // Alpha-beta pruning with move ordering
+    OpeningBook  // Compile-time table lookup (needs TTT_OPENING_BOOK)
+};
+
+#ifdef TTT_OPENING_BOOK
+const SearchMode DEFAULT_HARD_MODE = SearchMode::OpeningBook;
+#else
+const SearchMode DEFAULT_HARD_MODE = SearchMode::AlphaBeta;
+#endif
+
+// Order in which alphaBeta() tries the cells: center, corners, then edges
+const int MOVE_ORDER[CELLS] = { 4, 0, 2, 6, 8, 1, 3, 5, 7 };
+
+
+// ===================================================
+// Function: alphaBeta
+// Purpose : Minimax search with alpha-beta pruning
+// Input   :
+//   - game : incremental game state (restored before returning)
+//   - isMaximizing: true if it's AI's turn, false for Player
+//   - alpha: score the AI is already guaranteed elsewhere
+//   - beta : score the Player is already guaranteed elsewhere
+//   - table: optional transposition table to read and fill
+// Returns :
+//   - The exact minimax score if it lies between alpha and beta
+//   - Otherwise a bound on the side of the window it fell out of
+// Logic   :
+//   - Same scoring as minimax()
+//   - If the side to move can complete a line, that decides the score
+//   - If the other side threatens a line, only the blocking moves are
+//     searched (any other move loses at once)
+//   - Strong moves (center, corners) are tried first so that
+//     a refutation is found early and the rest can be skipped
+//   - Positions found in the table are narrowed or answered
+//     without searching them again
+// ===================================================
+int alphaBeta(GameState& game, bool isMaximizing, int alpha, int beta,
+              TranspositionTable* table = nullptr) {
+    searchNodes++;
+    int score = evaluate(game);
+    if (score == 10 || score == -10 || game.isFull())
+        return score;
+
+    char mover = isMaximizing ? AI : PLAYER;
+    char other = isMaximizing ? PLAYER : AI;
+    if (game.canWinNextMove(mover))
+        return isMaximizing ? 10 : -10;
+
+    int alphaOrig = alpha, betaOrig = beta;
+    uint32_t key = 0;
+    if (table) {
+        key = canonicalKey(game.board(), isMaximizing);
+        TTEntry entry;
+        if (table->probe(key, entry)) {
+            if (entry.bound == Bound::Exact) return entry.score;
+            if (entry.bound == Bound::Lower) alpha = max(alpha, int(entry.score));
+            if (entry.bound == Bound::Upper) beta = min(beta, int(entry.score));
+            if (alpha >= beta) return entry.score;
+        }
+    }
+
+    uint16_t moves = FULL_MASK & ~occupied(game.board());
+    if (game.canWinNextMove(other))
+        moves = game.winningCells(other);  // Must block
+
+    int best;
+    if (isMaximizing) {
+        best = -1000;
+        for (int cell : MOVE_ORDER) {
+            if (moves & (1 << cell)) {
+                game.makeMove(cell, AI);
+                best = max(best, alphaBeta(game, false, alpha, beta, table));
+                game.unmakeMove(cell, AI);
+                alpha = max(alpha, best);
+                if (alpha >= beta) break;  // Player will avoid this line
+            }
+        }
+    } else {
+        best = 1000;
+        for (int cell : MOVE_ORDER) {
+            if (moves & (1 << cell)) {
+                game.makeMove(cell, PLAYER);
+                best = min(best, alphaBeta(game, true, alpha, beta, table));
+                game.unmakeMove(cell, PLAYER);
+                beta = min(beta, best);
+                if (alpha >= beta) break;  // AI will avoid this line
+            }
+        }
+    }
+
+    if (table) {
+        Bound bound = best <= alphaOrig ? Bound::Upper
+                    : best >= betaOrig  ? Bound::Lower
+                                        : Bound::Exact;
+        table->store(key, best, bound);
+    }
+    return best;
+}
+
+
 // ===================================================
 // Function: makeHardAIMove
 // Purpose : Executes the best possible move using Minimax algorithm
-// Input   : The current game board
+// Input   :
+//   - game : incremental game state
+//   - mode : minimax, alpha-beta or opening book (see DEFAULT_HARD_MODE)
+//   - table: optional transposition table for alpha-beta mode
 // Behavior:
-//   - Tries all possible moves for AI
-//   - Uses minimax() to score each move
-//   - Picks the move with the highest score
+//   - In opening book mode, plays the stored move if there is one
+//   - Otherwise tries all possible moves for AI in cell order (A1, A2, ..., C3)
+//   - Scores each move with minimax() or alphaBeta()
+//   - Picks the first move with the highest score
+// Notes   : In alpha-beta mode each move only has to beat the best
+//           score so far, and the loop stops once a forced win is found.
+//           All modes pick the same move.
 // Result  : The AI makes an unbeatable move
 // ===================================================
-void makeHardAIMove(char board[SIZE][SIZE]) {
+void makeHardAIMove(GameState& game, SearchMode mode = DEFAULT_HARD_MODE,
+                    TranspositionTable* table = nullptr) {
     int bestVal = -1000;
-    int bestRow = -1, bestCol = -1;
+    int bestCell = -1;
 
-    for (int r = 0; r < SIZE; r++) {
-        for (int c = 0; c < SIZE; c++) {
-            if (board[r][c] == ' ') {
-                board[r][c] = AI;
-                int moveVal = minimax(board, false);
-                board[r][c] = ' ';
-
-                if (moveVal > bestVal) {
-                    bestRow = r;
-                    bestCol = c;
-                    bestVal = moveVal;
-                }
-            }
+#ifdef TTT_OPENING_BOOK
+    if (mode == SearchMode::OpeningBook && lookupOpeningBook(game.board(), bestCell, bestVal)) {
+        game.makeMove(bestCell, AI);
+        return;
+    }
+#endif
+
+    uint16_t taken = occupied(game.board());
+    for (int cell = 0; cell < CELLS; cell++) {
+        if (taken & (1 << cell)) continue;
+
+        game.makeMove(cell, AI);
+        int moveVal = (mode == SearchMode::Minimax)
+            ? minimax(game, false)
+            : alphaBeta(game, false, bestVal, 1000, table);
+        game.unmakeMove(cell, AI);
+
+        if (moveVal > bestVal) {
+            bestCell = cell;
+            bestVal = moveVal;
         }
+        if (mode != SearchMode::Minimax && bestVal == 10)
+            break;  // Forced win found, no later move can beat it
     }
 
-    board[bestRow][bestCol] = AI;
+    game.makeMove(bestCell, AI);
 }
 
 // ===================================================
 // Function: makeAIMove
 // Purpose : Executes an AI move based on selected difficulty
 // Input   : 
-//   - board     : current game board
+//   - game      : incremental game state
 //   - difficulty: AI difficulty level (1 = Easy, 2 = Medium, 3 = Hard)
+//   - table     : transposition table used by the hard AI (may be null)
 // Behavior:
 //   - Calls the appropriate AI strategy function:
 //       1 → Random (easy)
 //       2 → Block + win logic (medium)
-//       3 → Minimax (hard, unbeatable)
+//       3 → Alpha-beta minimax (hard, unbeatable)
 // ===================================================
-void makeAIMove(char board[SIZE][SIZE], int difficulty) {
+void makeAIMove(GameState& game, int difficulty, TranspositionTable* table = nullptr) {
     switch (difficulty) {
-        case 1: makeEasyAIMove(board); break;
-        case 2: makeMediumAIMove(board); break;
-        case 3: makeHardAIMove(board); break;
+        case 1: makeEasyAIMove(game); break;
+        case 2: makeMediumAIMove(game); break;
+        case 3: makeHardAIMove(game, DEFAULT_HARD_MODE, table); break;
     }
 }
 
@@ -393,8 +1029,10 @@ void playerMove(char board[SIZE][SIZE]) {
 // ===================================================
 // Function: playGame
 // Purpose : Runs the main game loop of Tic-Tac-Toe
+// Input   :
+//   - seed: seed for the random moves of the easy/medium AI
 // Behavior:
-//   - Initializes an empty board
+//   - Initializes an empty game state
 //   - Prompts user for:
 //       - Turn order (first or second)
 //       - AI difficulty level
@@ -403,27 +1041,34 @@ void playerMove(char board[SIZE][SIZE]) {
 //   - Ends when there's a winner or a draw
 //   - Announces the game result
 // ===================================================
-void playGame() {
-    char board[SIZE][SIZE] = { {' ', ' ', ' '}, {' ', ' ', ' '}, {' ', ' ', ' '} };
+void playGame(uint64_t seed) {
+    GameState game;
+    char board[SIZE][SIZE];  // Display/input copy of the state
     char winner = ' ';
-    srand(time(0)); // Random seed for AI moves
+    rng.seed(seed); // Random seed for AI moves
 
     bool playerFirst = isPlayerFirst();
     int difficulty = chooseDifficulty();
 
+    TranspositionTable table;  // The hard AI's positions, for this game
+
+    toCharBoard(game.board(), board);
     printBoard(board);
 
     while (true) {
         if (playerFirst) {
             playerMove(board);
+            uint16_t added = toBitboard(board).player & ~game.board().player;
+            game.makeMove(lowestCell(added), PLAYER);
         } else {
             cout << "AI is thinking...\n";
-            makeAIMove(board, difficulty);
+            makeAIMove(game, difficulty, &table);
+            toCharBoard(game.board(), board);
         }
 
         printBoard(board);
-        winner = checkWinner(board);
-        if (winner != ' ' || isDraw(board)) break;
+        winner = game.winner();
+        if (winner != ' ' || game.isFull()) break;
 
         playerFirst = !playerFirst; // Alternate turns
     }
@@ -438,11 +1083,1539 @@ void playGame() {
 }
 
 // ===================================================
-// Function: main
-// Purpose : Entry point of the program
-// Behavior: Calls playGame() to start the match
+// N×N board, K-in-a-row variant
+// ---------------------------------------------------
+// The 3x3 code above solves the game completely. On 4x4 and 5x5 boards
+// that is no longer possible, so the variant engine below searches to
+// a limited depth, scores unfinished positions with a heuristic, and
+// deepens the search until its time budget runs out.
 // ===================================================
-int main() {
-    playGame();
-    return 0;
+
+// Scores used by the variant search (AI-positive, like evaluate())
+const int WIN_SCORE = 100000000;  // Minus the ply, so faster wins score higher
+const int INF_SCORE = WIN_SCORE + 1;
+
+// The search and self-play threads: runtime::ThreadPool (runtime/thread_pool.h)
+// deals pool.run(count, fn) tasks round-robin and lets idle workers steal.
+using runtime::ThreadPool;
+
+
+// ===================================================
+// Class   : SharedTable
+// Purpose : Transposition table shared by all search threads
+// Notes   :
+//   - Lock-free: a slot holds two atomic words, the key XOR-ed with
+//     the data, and the data itself. If two threads write the same
+//     slot at once, the key check fails and the slot reads as empty.
+//   - One entry per slot, newer entries always replace older ones
+// ===================================================
+class SharedTable {
+public:
+    struct Entry {
+        int score = 0;
+        int depth = 0;              // Remaining depth the score is valid for
+        Bound bound = Bound::None;
+        int move = -1;              // Best cell found, -1 if none
+    };
+
+    explicit SharedTable(int bits = 20)
+        : mask((size_t(1) << bits) - 1), slots(new Slot[size_t(1) << bits]) {}
+
+    bool probe(uint64_t key, Entry& entry) const {
+        const Slot& slot = slots[key & mask];
+        uint64_t data = slot.data.load(memory_order_relaxed);
+        if ((slot.check.load(memory_order_relaxed) ^ data) != key) return false;
+        entry.score = int32_t(uint32_t(data));
+        entry.depth = int((data >> 32) & 0xFF);
+        entry.bound = Bound((data >> 40) & 0x3);
+        entry.move = int((data >> 48) & 0xFF) - 1;
+        return entry.bound != Bound::None;
+    }
+
+    void store(uint64_t key, const Entry& entry) {
+        uint64_t data = uint64_t(uint32_t(entry.score))
+                      | uint64_t(entry.depth & 0xFF) << 32
+                      | uint64_t(entry.bound) << 40
+                      | uint64_t(entry.move + 1) << 48;
+        Slot& slot = slots[key & mask];
+        slot.check.store(key ^ data, memory_order_relaxed);
+        slot.data.store(data, memory_order_relaxed);
+    }
+
+    void clear() {
+        for (size_t i = 0; i <= mask; i++) {
+            slots[i].check.store(0, memory_order_relaxed);
+            slots[i].data.store(0, memory_order_relaxed);
+        }
+    }
+
+private:
+    struct Slot {
+        atomic<uint64_t> check{0};
+        atomic<uint64_t> data{0};
+    };
+
+    size_t mask;
+    unique_ptr<Slot[]> slots;
+};
+
+
+// ===================================================
+// Position database
+// ---------------------------------------------------
+// Solved N×N positions, computed offline by --solve and loaded with
+// --db, so the hard AI answers them at once instead of searching.
+// The file is an open-addressing hash table that is mapped into
+// memory as it is: loading does no parsing, and a lookup reads one
+// or two 16-byte slots.
+//   - A PositionDbHeader, then 2^slotBits PositionDbSlots
+//   - Keys are canonical (see EngineNK::canonicalKey), so the 8
+//     rotations and reflections of a position share one slot; the
+//     move is stored in that canonical orientation
+//   - Only positions with the AI to move are stored
+//   - Native byte order; the header records it
+// ===================================================
+struct PositionDbHeader {
+    char magic[8];         // "TTTPOSDB"
+    uint32_t version;
+    uint32_t byteOrder;    // BYTE_ORDER_MARK as written
+    uint8_t n, k;          // Board size and line length
+    uint8_t plies;         // Positions with up to this many symbols are stored
+    uint8_t depthLimit;    // Search depth of the solver (n * n: to the end)
+    uint32_t slotBits;     // The table has 2^slotBits slots
+    uint64_t count;        // Positions stored
+};
+
+struct PositionDbSlot {
+    uint64_t key;          // EMPTY_KEY if the slot is unused
+    int32_t score;         // As findBestMove() scores it (WIN_SCORE - ply for a forced win)
+    uint8_t move;          // Best cell, in the canonical orientation
+    uint8_t depth;         // Depth the score was searched to
+    uint8_t exact;         // 1 if the search reached the end of the game
+    uint8_t reserved;
+};
+
+static_assert(sizeof(PositionDbHeader) == 32, "the header is part of the file format");
+static_assert(sizeof(PositionDbSlot) == 16, "the slot is part of the file format");
+
+// ===================================================
+// Class   : PositionDatabase
+// Purpose : Read-only, memory-mapped view of a --solve file
+// Notes   :
+//   - Without mmap() (not a POSIX system) the file is read into
+//     memory once instead; the lookup is the same
+//   - Half of the slots at most are used, so probes stay short
+// ===================================================
+class PositionDatabase {
+public:
+    static const uint32_t VERSION = 1;
+    static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+    static const uint64_t EMPTY_KEY = ~uint64_t(0);  // Not a position: every cell taken by both sides
+
+    PositionDatabase() = default;
+    ~PositionDatabase() { close(); }
+
+    PositionDatabase(const PositionDatabase&) = delete;
+    PositionDatabase& operator=(const PositionDatabase&) = delete;
+
+    // Slot of a key in a table of 2^bits slots (start of the probe sequence)
+    static uint64_t slotOf(uint64_t key, uint32_t bits) {
+        key ^= key >> 30; key *= 0xBF58476D1CE4E5B9ull;  // splitmix64 finalizer
+        key ^= key >> 27; key *= 0x94D049BB133111EBull;
+        return (key ^ (key >> 31)) & ((uint64_t(1) << bits) - 1);
+    }
+
+    // ===================================================
+    // Function: open
+    // Purpose : Maps the database at 'path' for a board of n×n, k in a row
+    // Returns : false (with a message on cerr) if the file cannot be
+    //           read, is not a database or belongs to another board
+    // ===================================================
+    bool open(const string& path, int n, int k) {
+        close();
+#if defined(TTT_HAVE_MMAP)
+        int fd = ::open(path.c_str(), O_RDONLY);
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) != 0) {
+            cerr << "Cannot open position database: " << path << "\n";
+            if (fd >= 0) ::close(fd);
+            return false;
+        }
+        bytes = size_t(info.st_size);
+        void* view = bytes ? mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        ::close(fd);  // The mapping stays valid
+        if (view == MAP_FAILED) {
+            cerr << "Cannot map position database: " << path << "\n";
+            bytes = 0;
+            return false;
+        }
+        data = static_cast<const unsigned char*>(view);
+        mapped = true;
+#else
+        ifstream in(path, ios::binary);
+        if (!in) {
+            cerr << "Cannot open position database: " << path << "\n";
+            return false;
+        }
+        copy.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        data = reinterpret_cast<const unsigned char*>(copy.data());
+        bytes = copy.size();
+#endif
+
+        const PositionDbHeader* h = reinterpret_cast<const PositionDbHeader*>(data);
+        bool valid = bytes >= sizeof(PositionDbHeader)
+                  && memcmp(h->magic, "TTTPOSDB", 8) == 0 && h->version == VERSION
+                  && h->byteOrder == BYTE_ORDER_MARK && h->slotBits < 40
+                  && bytes == sizeof(PositionDbHeader) + (size_t(1) << h->slotBits) * sizeof(PositionDbSlot)
+                  && 2 * h->count <= (uint64_t(1) << h->slotBits);  // write() leaves half the slots empty
+        if (!valid) {
+            cerr << "Not a position database (or written on another kind of machine): " << path << "\n";
+            close();
+            return false;
+        }
+        if (h->n != n || h->k != k) {
+            cerr << "Position database " << path << " is for " << int(h->n) << "x" << int(h->n)
+                 << " with " << int(h->k) << " in a row\n";
+            close();
+            return false;
+        }
+        slots = reinterpret_cast<const PositionDbSlot*>(data + sizeof(PositionDbHeader));
+        return true;
+    }
+
+    void close() {
+#if defined(TTT_HAVE_MMAP)
+        if (mapped) munmap(const_cast<unsigned char*>(data), bytes);
+#endif
+        copy.clear();
+        data = nullptr;
+        slots = nullptr;
+        bytes = 0;
+        mapped = false;
+    }
+
+    bool isOpen() const { return slots != nullptr; }
+
+    const PositionDbHeader& header() const { return *reinterpret_cast<const PositionDbHeader*>(data); }
+
+    // Returns the slot of a canonical key, or nullptr if it is not stored.
+    // Probes each slot once at most, so a damaged file without empty
+    // slots (the header count may be wrong) cannot make it loop forever.
+    const PositionDbSlot* find(uint64_t key) const {
+        uint32_t bits = header().slotBits;
+        uint64_t mask = (uint64_t(1) << bits) - 1;
+        uint64_t i = slotOf(key, bits);
+        for (uint64_t probes = 0; probes <= mask; probes++, i = (i + 1) & mask) {
+            if (slots[i].key == key) return &slots[i];
+            if (slots[i].key == EMPTY_KEY) return nullptr;
+        }
+        return nullptr;
+    }
+
+    // ===================================================
+    // Function: write
+    // Purpose : Builds the hash table of 'entries' and writes the file
+    // Input   :
+    //   - info   : n, k, plies and depthLimit of the header (the rest
+    //              is filled in here)
+    //   - entries: the solved positions, keys unique
+    // Returns : false if the file cannot be written
+    // ===================================================
+    static bool write(const string& path, PositionDbHeader info, const vector<PositionDbSlot>& entries) {
+        uint32_t bits = 4;
+        while ((uint64_t(1) << bits) < 2 * uint64_t(entries.size())) bits++;
+        PositionDbSlot empty{};
+        empty.key = EMPTY_KEY;
+        vector<PositionDbSlot> table(size_t(1) << bits, empty);
+        uint64_t mask = table.size() - 1;
+        for (const PositionDbSlot& entry : entries) {
+            uint64_t i = slotOf(entry.key, bits);
+            while (table[i].key != EMPTY_KEY) i = (i + 1) & mask;
+            table[i] = entry;
+        }
+
+        memcpy(info.magic, "TTTPOSDB", 8);
+        info.version = VERSION;
+        info.byteOrder = BYTE_ORDER_MARK;
+        info.slotBits = bits;
+        info.count = entries.size();
+        ofstream out(path, ios::binary | ios::trunc);
+        out.write(reinterpret_cast<const char*>(&info), sizeof(info));
+        out.write(reinterpret_cast<const char*>(table.data()), streamsize(table.size() * sizeof(PositionDbSlot)));
+        return bool(out.flush());
+    }
+
+private:
+    const unsigned char* data = nullptr;
+    const PositionDbSlot* slots = nullptr;
+    size_t bytes = 0;
+    bool mapped = false;
+    vector<char> copy;  // The file, where it cannot be mapped
+};
+
+
+// ===================================================
+// Class   : EngineNK
+// Purpose : Board logic and hard-mode search for N×N, K-in-a-row
+// Template:
+//   - N: board width and height (N * N <= 64)
+//   - K: number of symbols in a row needed to win (K <= N)
+// Notes   :
+//   - The state is a pair of bit masks, cell (r, c) in bit r * N + c
+//   - Every K-long line is precomputed once as a mask, together with
+//     the list of lines through each cell, so a win is detected by
+//     checking only the lines through the last-placed cell
+//   - The root moves are searched in parallel on a thread pool, with
+//     one SharedTable for all threads that lives as long as the engine
+//   - With a position database (useDatabase), stored positions are
+//     answered from it without a search
+// ===================================================
+template <int N, int K>
+class EngineNK {
+public:
+    static_assert(N * N <= 64, "board must fit in a 64-bit mask");
+    static_assert(K >= 2 && K <= N, "K must be between 2 and N");
+    static_assert(K <= 6, "heuristic weights only cover K <= 6");
+
+    static constexpr int CELLS = N * N;
+    static constexpr int STEPS = N - K + 1;  // Start positions of a line per row
+    static constexpr int LINES = 2 * N * STEPS + 2 * STEPS * STEPS;
+    static constexpr uint64_t FULL = (CELLS == 64) ? ~uint64_t(0) : (uint64_t(1) << CELLS) - 1;
+
+    struct State {
+        uint64_t player = 0;
+        uint64_t ai = 0;
+    };
+
+    // Search counters of the last findBestMove() call
+    struct SearchStats {
+        int depth = 0;        // Last fully searched depth
+        int score = 0;        // Score of the chosen move at that depth
+        uint64_t nodes = 0;   // Positions visited in total, all threads
+        bool fromDatabase = false;  // Answered by the position database (depth: as solved)
+    };
+
+    // threads: search threads (1 = search on the calling thread only)
+    // tableBits: the shared table has 2^tableBits slots of 16 bytes
+    explicit EngineNK(int threads = 1, int tableBits = 20)
+        : pool(threads), table(tableBits), searchers(pool.size()) {
+        for (Searcher& searcher : searchers) searcher.engine = this;
+    }
+
+    static uint64_t cellMask(int cell) { return uint64_t(1) << cell; }
+
+    // Answers stored positions from 'db' (null: always search). The
+    // database must stay open as long as the engine uses it.
+    void useDatabase(const PositionDatabase* db) { database = db; }
+
+    // Cell that 'cell' moves to under symmetry 0-7 of the board
+    // (0 is the identity), and back
+    static int transformCell(int cell, int symmetry) { return symmetries().to[symmetry][cell]; }
+    static int untransformCell(int cell, int symmetry) { return symmetries().from[symmetry][cell]; }
+
+    static State transform(const State& state, int symmetry) {
+        State result;
+        for (uint64_t m = state.player; m; m &= m - 1)
+            result.player |= cellMask(transformCell(popCount((m & (~m + 1)) - 1), symmetry));
+        for (uint64_t m = state.ai; m; m &= m - 1)
+            result.ai |= cellMask(transformCell(popCount((m & (~m + 1)) - 1), symmetry));
+        return result;
+    }
+
+    // ===================================================
+    // Function: canonicalKey
+    // Purpose : Position database key of a position, AI to move
+    // Returns : The smallest (player << CELLS | ai) over the 8
+    //           symmetries, as canonicalKey() of the 3x3 game;
+    //           'symmetry' receives the one that gives it
+    // ===================================================
+    static uint64_t canonicalKey(const State& state, int& symmetry) {
+        static_assert(2 * CELLS <= 64, "database keys need both masks in 64 bits");
+        uint64_t best = ~uint64_t(0);
+        symmetry = 0;
+        for (int s = 0; s < 8; s++) {
+            State t = transform(state, s);
+            uint64_t key = t.player << CELLS | t.ai;
+            if (key < best) {
+                best = key;
+                symmetry = s;
+            }
+        }
+        return best;
+    }
+
+    static uint64_t occupied(const State& state) { return state.player | state.ai; }
+
+    static bool isFull(const State& state) {
+        return occupied(state) == FULL;
+    }
+
+    // ===================================================
+    // Function: isWinningMove
+    // Purpose : Checks if the symbol just placed on 'cell' completes a line
+    // Input   :
+    //   - own : mask of the side that moved (including 'cell')
+    //   - cell: the cell that was just taken
+    // Logic   : Only the lines through 'cell' can have changed
+    // ===================================================
+    static bool isWinningMove(uint64_t own, int cell) {
+        const Lines& t = lines();
+        for (int i = 0; i < t.throughCount[cell]; i++) {
+            uint64_t line = t.masks[t.through[cell][i]];
+            if ((own & line) == line) return true;
+        }
+        return false;
+    }
+
+    // Returns an empty cell that wins for 'own', or -1 if there is none
+    static int findWinningCell(uint64_t own, uint64_t taken) {
+        for (int cell = 0; cell < CELLS; cell++)
+            if (!(taken & cellMask(cell)) && isWinningMove(own | cellMask(cell), cell))
+                return cell;
+        return -1;
+    }
+
+    // ===================================================
+    // Function: evaluate
+    // Purpose : Heuristic score of a position without a winner
+    // Returns : Positive if the AI stands better, negative for the Player
+    // Logic   : Counts open lines, i.e. lines that only one side has
+    //           symbols in. A line with c symbols is worth 10^(c-1),
+    //           so lines closer to completion dominate.
+    // ===================================================
+    static int evaluate(const State& state) {
+        static const int WEIGHTS[7] = { 0, 1, 10, 100, 1000, 10000, 100000 };
+        const Lines& t = lines();
+        int score = 0;
+        for (int i = 0; i < LINES; i++) {
+            uint64_t line = t.masks[i];
+            int a = int(bitset<64>(state.ai & line).count());
+            int p = int(bitset<64>(state.player & line).count());
+            if (p == 0) score += WEIGHTS[a];
+            else if (a == 0) score -= WEIGHTS[p];
+        }
+        return score;
+    }
+
+    // ===================================================
+    // Function: findBestMove
+    // Purpose : Hard-mode move choice by iterative deepening
+    // Input   :
+    //   - state   : current position, AI to move
+    //   - budgetMs: time budget for this move in milliseconds
+    //   - stats   : optional counters of the search
+    //   - maxDepth: optional depth limit (for benchmarks)
+    // Returns : The chosen cell (-1 if the board is full)
+    // Behavior:
+    //   - Searches depth 1, 2, 3, ... with alpha-beta
+    //   - At each depth the root moves are shared out to the pool,
+    //     best moves of the last depth first
+    //   - Stops when time is up, the game is solved, or a forced
+    //     win or loss is found
+    //   - Uses the result of the deepest depth that finished in time
+    //     (depth 1 always finishes)
+    //   - Ties go to the lowest cell index
+    // Notes   : Every root move is searched with a window just below
+    //           the best exact score found so far, so a move that ties
+    //           still gets its exact score. Together with table cutoffs
+    //           only being taken at the same depth, this makes the move
+    //           at a given depth the same for any number of threads.
+    // ===================================================
+    int findBestMove(State state, double budgetMs, SearchStats* stats = nullptr,
+                     int maxDepth = CELLS) {
+        root = state;
+        aborted = false;
+        timeLimited = false;
+        deadline = chrono::steady_clock::now()
+                 + chrono::duration_cast<chrono::steady_clock::duration>(
+                       chrono::duration<double, milli>(budgetMs));
+        for (Searcher& searcher : searchers) searcher.nodes = 0;
+        RUNTIME_TRACE_SCOPE("findBestMove");
+
+        if (database && occupied(state) != FULL) {
+            int symmetry = 0;
+            if (const PositionDbSlot* slot = database->find(canonicalKey(state, symmetry))) {
+                if (stats) {
+                    stats->depth = slot->depth;
+                    stats->score = slot->score;
+                    stats->nodes = 0;
+                    stats->fromDatabase = true;
+                }
+                return untransformCell(slot->move, symmetry);
+            }
+        }
+
+        // Scratch lists of this call, from the thread's arena (no malloc once it has grown)
+        runtime::ArenaScope scratch(runtime::threadArena());
+        runtime::ArenaVector<int> order(scratch);  // Root moves, best first
+        order.reserve(CELLS);
+        for (int cell : centerOrder())
+            if (!(occupied(root) & cellMask(cell))) order.push_back(cell);
+        if (order.empty()) return -1;
+
+        int moves = int(order.size());
+        int bestCell = order[0], bestScore = 0, bestDepth = 0;
+        runtime::ArenaVector<int> scores(moves, 0, scratch), rank(moves, 0, scratch), sorted(moves, 0, scratch);
+
+        for (int depth = 1; depth <= min(moves, maxDepth); depth++) {
+            RUNTIME_TRACE_SCOPE("depth");
+            timeLimited = depth > 1;
+            atomic<int> sharedBest{-INF_SCORE};  // Best exact score at this depth
+
+            pool.run(moves, [&](int i, int worker) {
+                RUNTIME_TRACE_SCOPE("root move");
+                Searcher& searcher = searchers[worker];
+                int best = sharedBest.load();
+                int alpha = (best == -INF_SCORE) ? -INF_SCORE : best - 1;
+
+                searcher.pos = root;
+                searcher.pos.ai |= cellMask(order[i]);
+                int score = searcher.search(depth - 1, 1, false, alpha, INF_SCORE, order[i]);
+                scores[i] = score;
+
+                while (score > best && !sharedBest.compare_exchange_weak(best, score)) {}
+            });
+            if (aborted) break;
+
+            int iterBest = -INF_SCORE, iterCell = -1;
+            for (int i = 0; i < moves; i++)
+                if (scores[i] > iterBest || (scores[i] == iterBest && order[i] < iterCell)) {
+                    iterBest = scores[i];
+                    iterCell = order[i];
+                }
+            bestCell = iterCell;
+            bestScore = iterBest;
+            bestDepth = depth;
+
+            for (int i = 0; i < moves; i++) rank[i] = i;
+            stable_sort(rank.begin(), rank.end(),
+                        [&](int a, int b) { return scores[a] > scores[b]; });
+            for (int i = 0; i < moves; i++) sorted[i] = order[rank[i]];
+            order.swap(sorted);
+
+            if (abs(bestScore) >= WIN_SCORE - CELLS) break;  // Forced result
+        }
+
+        if (stats) {
+            stats->depth = bestDepth;
+            stats->score = bestScore;
+            stats->nodes = 0;
+            stats->fromDatabase = false;
+            for (const Searcher& searcher : searchers) stats->nodes += searcher.nodes;
+        }
+        return bestCell;
+    }
+
+    // Forgets all stored search results (e.g. between unrelated games)
+    void clearTable() { table.clear(); }
+
+private:
+    // Precomputed K-long lines and the lines through each cell
+    struct Lines {
+        uint64_t masks[LINES];
+        int through[CELLS][4 * K];
+        int throughCount[CELLS];
+    };
+
+    static const Lines& lines() {
+        static const Lines lineTable = buildLines();
+        return lineTable;
+    }
+
+    static Lines buildLines() {
+        Lines t{};
+        const int DIRS[4][2] = { { 0, 1 }, { 1, 0 }, { 1, 1 }, { 1, -1 } };
+        int n = 0;
+        for (const auto& d : DIRS)
+            for (int r = 0; r < N; r++)
+                for (int c = 0; c < N; c++) {
+                    int endR = r + d[0] * (K - 1), endC = c + d[1] * (K - 1);
+                    if (endR < 0 || endR >= N || endC < 0 || endC >= N) continue;
+                    uint64_t mask = 0;
+                    for (int i = 0; i < K; i++)
+                        mask |= cellMask((r + d[0] * i) * N + (c + d[1] * i));
+                    t.masks[n] = mask;
+                    for (int cell = 0; cell < CELLS; cell++)
+                        if (mask & cellMask(cell))
+                            t.through[cell][t.throughCount[cell]++] = n;
+                    n++;
+                }
+        return t;
+    }
+
+    // The 8 rotations and reflections as cell maps: cell i goes to to[s][i]
+    struct Symmetries {
+        int to[8][CELLS];
+        int from[8][CELLS];
+    };
+
+    static const Symmetries& symmetries() {
+        static const Symmetries table = [] {
+            Symmetries t{};
+            for (int cell = 0; cell < CELLS; cell++) {
+                int r = cell / N, c = cell % N, m = N - 1;
+                const int mapped[8][2] = { { r, c }, { c, m - r }, { m - r, m - c }, { m - c, r },
+                                           { r, m - c }, { m - r, c }, { c, r }, { m - c, m - r } };
+                for (int s = 0; s < 8; s++) {
+                    t.to[s][cell] = mapped[s][0] * N + mapped[s][1];
+                    t.from[s][t.to[s][cell]] = cell;
+                }
+            }
+            return t;
+        }();
+        return table;
+    }
+
+    // Cells sorted by distance from the center (ties by index), since
+    // central cells take part in the most lines
+    static const vector<int>& centerOrder() {
+        static const vector<int> order = [] {
+            vector<int> cells(CELLS);
+            for (int i = 0; i < CELLS; i++) cells[i] = i;
+            auto dist = [](int cell) {
+                int dr = 2 * (cell / N) - (N - 1), dc = 2 * (cell % N) - (N - 1);
+                return dr * dr + dc * dc;
+            };
+            stable_sort(cells.begin(), cells.end(),
+                        [&](int a, int b) { return dist(a) < dist(b); });
+            return cells;
+        }();
+        return order;
+    }
+
+    // Table key of a position (the side to move is part of the key)
+    static uint64_t hashState(const State& state, bool isMaximizing) {
+        auto mix = [](uint64_t x) {  // splitmix64 finalizer
+            x ^= x >> 30; x *= 0xBF58476D1CE4E5B9ull;
+            x ^= x >> 27; x *= 0x94D049BB133111EBull;
+            return x ^ (x >> 31);
+        };
+        const uint64_t AI_TO_MOVE = 0x9E3779B97F4A7C15ull;
+        return mix(state.player ^ mix(state.ai) ^ (isMaximizing ? AI_TO_MOVE : 0));
+    }
+
+    // Win scores depend on the ply, so the table stores them relative
+    // to the position and they are converted back on the way out
+    static int toTable(int score, int ply) {
+        if (score >= WIN_SCORE - CELLS) return score + ply;
+        if (score <= -(WIN_SCORE - CELLS)) return score - ply;
+        return score;
+    }
+
+    static int fromTable(int score, int ply) {
+        if (score >= WIN_SCORE - CELLS) return score - ply;
+        if (score <= -(WIN_SCORE - CELLS)) return score + ply;
+        return score;
+    }
+
+    // Search state of one thread
+    struct Searcher {
+        EngineNK* engine = nullptr;
+        State pos;            // Position being searched (restored after each move)
+        uint64_t nodes = 0;
+
+        // ===================================================
+        // Function: search
+        // Purpose : Depth-limited alpha-beta below the root
+        // Input   :
+        //   - depth   : remaining depth (0 → heuristic score)
+        //   - ply     : distance from the root
+        //   - isMaximizing: true if it's AI's turn
+        //   - lastCell: cell the other side just played
+        // Returns : Score as in alphaBeta(), with WIN_SCORE - ply for wins
+        // ===================================================
+        int search(int depth, int ply, bool isMaximizing, int alpha, int beta, int lastCell) {
+            EngineNK& e = *engine;
+            if ((++nodes & 1023) == 0 && e.timeLimited
+                && chrono::steady_clock::now() >= e.deadline)
+                e.aborted = true;
+            if (e.aborted) return 0;  // Result is thrown away
+
+            // Only the side that just moved can have won
+            if (isMaximizing ? isWinningMove(pos.player, lastCell)
+                             : isWinningMove(pos.ai, lastCell))
+                return isMaximizing ? -(WIN_SCORE - ply) : WIN_SCORE - ply;
+            if (isFull(pos)) return 0;
+            if (depth == 0) return evaluate(pos);
+
+            // Scores are only reused from the same depth, moves from any depth
+            int alphaOrig = alpha, betaOrig = beta;
+            uint64_t key = hashState(pos, isMaximizing);
+            SharedTable::Entry entry;
+            int tableMove = -1;
+            if (e.table.probe(key, entry)) {
+                tableMove = entry.move;
+                if (entry.depth == depth) {
+                    int score = fromTable(entry.score, ply);
+                    if (entry.bound == Bound::Exact) return score;
+                    if (entry.bound == Bound::Lower) alpha = max(alpha, score);
+                    if (entry.bound == Bound::Upper) beta = min(beta, score);
+                    if (alpha >= beta) return score;
+                }
+            }
+
+            uint64_t taken = occupied(pos);
+            int best = isMaximizing ? -INF_SCORE : INF_SCORE;
+            int bestMove = -1;
+            for (int i = -1; i < CELLS; i++) {
+                int cell = (i < 0) ? tableMove : centerOrder()[i];
+                if (cell < 0 || (i >= 0 && cell == tableMove)) continue;
+                uint64_t bit = cellMask(cell);
+                if (taken & bit) continue;
+
+                int score;
+                if (isMaximizing) {
+                    pos.ai |= bit;
+                    score = search(depth - 1, ply + 1, false, alpha, beta, cell);
+                    pos.ai &= ~bit;
+                    if (score > best) { best = score; bestMove = cell; }
+                    alpha = max(alpha, best);
+                } else {
+                    pos.player |= bit;
+                    score = search(depth - 1, ply + 1, true, alpha, beta, cell);
+                    pos.player &= ~bit;
+                    if (score < best) { best = score; bestMove = cell; }
+                    beta = min(beta, best);
+                }
+                if (alpha >= beta) break;
+            }
+
+            if (!e.aborted) {
+                entry.score = toTable(best, ply);
+                entry.depth = depth;
+                entry.bound = best <= alphaOrig ? Bound::Upper
+                            : best >= betaOrig  ? Bound::Lower
+                                                : Bound::Exact;
+                entry.move = bestMove;
+                e.table.store(key, entry);
+            }
+            return best;
+        }
+    };
+
+    ThreadPool pool;
+    SharedTable table;
+    vector<Searcher> searchers;  // One per pool worker
+    const PositionDatabase* database = nullptr;
+
+    State root;                     // Position of the current findBestMove()
+    atomic<bool> timeLimited{false};  // Depth 1 always runs to the end
+    atomic<bool> aborted{false};
+    chrono::steady_clock::time_point deadline;
+};
+
+
+// ===================================================
+// Function: printBoardNK
+// Purpose : Displays an N×N board, same layout as printBoard()
+// ===================================================
+template <int N, int K>
+void printBoardNK(const typename EngineNK<N, K>::State& state) {
+    cout << "\n   ";
+    for (int c = 0; c < N; c++) cout << " " << c + 1 << (c < N - 1 ? "  " : "\n");
+    for (int r = 0; r < N; r++) {
+        cout << char('A' + r) << " | ";
+        for (int c = 0; c < N; c++) {
+            uint64_t bit = uint64_t(1) << (r * N + c);
+            cout << ((state.player & bit) ? PLAYER : (state.ai & bit) ? AI : ' ');
+            if (c < N - 1) cout << " | ";
+        }
+        cout << "\n";
+        if (r < N - 1) {
+            cout << "  |";
+            for (int c = 0; c < N; c++) cout << (c < N - 1 ? "---|" : "---\n");
+        }
+    }
+    cout << "\n";
+}
+
+// ===================================================
+// Function: playerMoveNK
+// Purpose : Reads and plays the human move on an N×N board
+// Returns : The cell that was taken
+// Notes   : Same input rules as playerMove() (A1, 1A, b3, ...)
+// ===================================================
+template <int N, int K>
+int playerMoveNK(typename EngineNK<N, K>::State& state) {
+    string move;
+    string last = string(1, char('A' + N - 1)) + char('0' + N);
+    cout << "Your move (e.g., A1, B3): ";
+    while (true) {
+        cin >> move;
+
+        if (move.length() != 2) {
+            cout << "Invalid format. Use A1–" << last << ": ";
+            continue;
+        }
+
+        char rChar = move[0];
+        char cChar = move[1];
+        if (isdigit(rChar)) swap(rChar, cChar);  // Allow 1A as well as A1
+
+        int row = toupper(rChar) - 'A';
+        int col = cChar - '1';
+        int cell = row * N + col;
+
+        if (row < 0 || row >= N || col < 0 || col >= N) {
+            cout << "Invalid cell. Use A1–" << last << ": ";
+        } else if (EngineNK<N, K>::occupied(state) & (uint64_t(1) << cell)) {
+            cout << "Cell taken. Try again: ";
+        } else {
+            state.player |= uint64_t(1) << cell;
+            return cell;
+        }
+    }
+}
+
+// ===================================================
+// Function: makeAIMoveNK
+// Purpose : AI move on an N×N board for the selected difficulty
+// Input   :
+//   - engine    : the search engine (used by hard mode)
+//   - state     : current position
+//   - difficulty: 1 = random, 2 = win/block, 3 = iterative deepening
+//   - budgetMs  : time budget per hard-mode move
+// Returns : The cell that was taken
+// ===================================================
+template <int N, int K>
+int makeAIMoveNK(EngineNK<N, K>& engine, typename EngineNK<N, K>::State& state,
+                 int difficulty, double budgetMs) {
+    typedef EngineNK<N, K> Engine;
+    uint64_t taken = Engine::occupied(state);
+    int cell = -1;
+
+    if (difficulty == 3) {
+        typename Engine::SearchStats stats;
+        cell = engine.findBestMove(state, budgetMs, &stats);
+        if (stats.fromDatabase) cout << "(position database, depth " << stats.depth << ")\n";
+        else cout << "(depth " << stats.depth << ", " << stats.nodes << " nodes)\n";
+    } else if (difficulty == 2) {
+        cell = Engine::findWinningCell(state.ai, taken);  // Take winning move
+        if (cell < 0)
+            cell = Engine::findWinningCell(state.player, taken);  // Block
+    }
+
+    // Easy, or nothing to win or block: random empty cell
+    if (cell < 0) {
+        uint64_t empty = ~taken & Engine::FULL;
+        cell = nthSetBit(empty, int(rng.below(uint32_t(popCount(empty)))));
+    }
+
+    state.ai |= Engine::cellMask(cell);
+    return cell;
+}
+
+// ===================================================
+// Function: playGameNK
+// Purpose : Game loop for the N×N, K-in-a-row variant
+// Input   :
+//   - budgetMs: time budget per hard-mode AI move
+//   - threads : search threads for the hard AI
+//   - seed    : seed for the random moves of the easy/medium AI
+//   - dbPath  : position database for the hard AI (empty: none)
+// Returns : false if the database cannot be opened
+// Behavior: Same flow as playGame(), with win detection on the
+//           lines through the last move only
+// ===================================================
+template <int N, int K>
+bool playGameNK(double budgetMs, int threads, uint64_t seed, const string& dbPath) {
+    typedef EngineNK<N, K> Engine;
+    typename Engine::State state;
+    Engine engine(threads);
+    PositionDatabase database;
+    if (!dbPath.empty()) {
+        if (!database.open(dbPath, N, K)) return false;
+        engine.useDatabase(&database);
+        cout << "Position database: " << database.header().count << " position(s) with up to "
+             << int(database.header().plies) << " symbols\n";
+    }
+    char winner = ' ';
+    rng.seed(seed);
+
+    cout << N << "x" << N << " board, " << K << " in a row wins.\n";
+    bool playerFirst = isPlayerFirst();
+    int difficulty = chooseDifficulty();
+
+    printBoardNK<N, K>(state);
+
+    while (true) {
+        int cell;
+        if (playerFirst) {
+            cell = playerMoveNK<N, K>(state);
+        } else {
+            cout << "AI is thinking...\n";
+            cell = makeAIMoveNK<N, K>(engine, state, difficulty, budgetMs);
+        }
+
+        printBoardNK<N, K>(state);
+        if (Engine::isWinningMove(playerFirst ? state.player : state.ai, cell)) {
+            winner = playerFirst ? PLAYER : AI;
+            break;
+        }
+        if (Engine::isFull(state)) break;
+
+        playerFirst = !playerFirst;
+    }
+
+    if (winner == PLAYER)
+        cout << "🎉 You win!\n";
+    else if (winner == AI)
+        cout << "💻 AI wins!\n";
+    else
+        cout << "It's a draw!\n";
+    return true;
+}
+
+// ===================================================
+// Function: solvePositionsNK
+// Purpose : Offline solver: fills a position database (--solve)
+// Input   :
+//   - path   : database file to write
+//   - plies  : positions with up to this many symbols are solved
+//   - depth  : search depth per position (0 = to the end of the game)
+//   - threads: search threads
+// Returns : The exit code for main()
+// Behavior:
+//   - Plays out every game from the empty board, with either side
+//     first, for 'plies' moves, and keeps each position with the
+//     AI to move and no winner once (up to symmetry)
+//   - Searches each with findBestMove() and no time limit. All of
+//     them share the engine's table, so later positions reuse the
+//     subtrees of earlier ones
+//   - Positions are solved in the canonical orientation; the tie
+//     between equal moves may fall on another (equally good) cell
+//     than a live search of the same position would pick
+// ===================================================
+template <int N, int K>
+int solvePositionsNK(const string& path, int plies, int depth, int threads) {
+    typedef EngineNK<N, K> Engine;
+    typedef typename Engine::State State;
+    const int CELLS = Engine::CELLS;
+    plies = max(0, min(plies, CELLS - 1));
+    if (depth <= 0 || depth > CELLS) depth = CELLS;
+
+    // Every position with the AI to move, canonical, fewest symbols first
+    vector<State> positions;
+    unordered_set<uint64_t> seen;  // Canonical keys, twice plus the side to move
+    function<void(const State&, bool, int)> visit = [&](const State& state, bool aiToMove, int symbols) {
+        int symmetry = 0;
+        uint64_t key = Engine::canonicalKey(state, symmetry) * 2 + (aiToMove ? 1 : 0);
+        if (!seen.insert(key).second) return;
+        if (aiToMove) positions.push_back(Engine::transform(state, symmetry));
+        if (symbols == plies) return;
+
+        uint64_t taken = Engine::occupied(state);
+        for (int cell = 0; cell < CELLS; cell++) {
+            if (taken & Engine::cellMask(cell)) continue;
+            State next = state;
+            uint64_t& own = aiToMove ? next.ai : next.player;
+            own |= Engine::cellMask(cell);
+            if (Engine::isWinningMove(own, cell) || Engine::isFull(next)) continue;
+            visit(next, !aiToMove, symbols + 1);
+        }
+    };
+    visit(State(), true, 0);   // AI first
+    visit(State(), false, 0);  // Player first
+    stable_sort(positions.begin(), positions.end(), [](const State& a, const State& b) {
+        return popCount(Engine::occupied(a)) < popCount(Engine::occupied(b));
+    });
+
+    cout << "Solving " << positions.size() << " position(s) of " << N << "x" << N << ", " << K
+         << " in a row, up to " << plies << " symbols, depth " << depth
+         << (depth == CELLS ? " (to the end)" : "") << ", " << threads << " thread(s)\n";
+    Engine engine(threads, 22);
+    vector<PositionDbSlot> entries;
+    entries.reserve(positions.size());
+    uint64_t nodes = 0, exact = 0;
+    auto start = chrono::steady_clock::now(), lastReport = start;
+    for (const State& position : positions) {
+        typename Engine::SearchStats stats;
+        int cell = engine.findBestMove(position, 1e9, &stats, depth);
+        int symmetry = 0;
+        PositionDbSlot entry{};
+        entry.key = Engine::canonicalKey(position, symmetry);  // The identity: 'position' is canonical
+        entry.score = stats.score;
+        entry.move = uint8_t(cell);
+        entry.depth = uint8_t(stats.depth);
+        entry.exact = (stats.depth == CELLS - popCount(Engine::occupied(position))
+                       || abs(stats.score) >= WIN_SCORE - CELLS) ? 1 : 0;
+        entries.push_back(entry);
+        nodes += stats.nodes;
+        exact += entry.exact;
+
+        auto now = chrono::steady_clock::now();
+        if (now - lastReport >= chrono::seconds(5)) {
+            lastReport = now;
+            cout << "  " << entries.size() << "/" << positions.size() << " positions, "
+                 << fixed << setprecision(1) << chrono::duration<double>(now - start).count() << " s\n";
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    PositionDbHeader info{};
+    info.n = uint8_t(N);
+    info.k = uint8_t(K);
+    info.plies = uint8_t(plies);
+    info.depthLimit = uint8_t(depth);
+    if (!PositionDatabase::write(path, info, entries)) {
+        cerr << "Cannot write position database: " << path << "\n";
+        return 1;
+    }
+    cout << fixed << setprecision(2) << "Wrote " << path << ": " << entries.size() << " position(s), "
+         << exact << " solved to the end, " << double(nodes) / 1e6 << " M nodes in " << seconds << " s\n";
+    return 0;
+}
+
+// ===================================================
+// Headless self-play
+// ---------------------------------------------------
+// Plays many 3x3 games between two AI strategies, with no console
+// input, on all threads. Used as the throughput benchmark and as a
+// strength check after engine changes (e.g. Hard must never lose).
+// ===================================================
+
+// Move and query times in nanoseconds: 32 buckets per power of two
+// (about 3% error), so millions of moves fit in 15 KB. Histograms of
+// different threads are merged at the end.
+using LatencyHistogram = runtime::Histogram<32>;
+
+// Results of one self-play run (or one thread's share of it)
+struct SelfPlayStats {
+    uint64_t games = 0;
+    uint64_t xWins = 0, oWins = 0, draws = 0;
+    uint64_t nodes = 0;              // Search nodes of both sides
+    LatencyHistogram latency[2];     // Move times of X [0] and O [1]
+
+    void merge(const SelfPlayStats& other) {
+        games += other.games;
+        xWins += other.xWins;
+        oWins += other.oWins;
+        draws += other.draws;
+        nodes += other.nodes;
+        latency[0].merge(other.latency[0]);
+        latency[1].merge(other.latency[1]);
+    }
+};
+
+// ===================================================
+// Function: playSelfPlayGame
+// Purpose : Plays one game between two AI levels, X moving first
+// Input   :
+//   - xLevel, oLevel: difficulty (1-3) of each side
+//   - table : this thread's transposition table
+//   - stats : counters to add the game to
+// Notes   : The AI functions always play 'O', so X's moves are made
+//           with the sides swapped.
+// ===================================================
+void playSelfPlayGame(int xLevel, int oLevel, TranspositionTable& table,
+                      SelfPlayStats& stats) {
+    GameState game;
+    bool xTurn = true;
+    uint64_t nodesBefore = searchNodes;
+
+    while (true) {
+        auto start = chrono::steady_clock::now();
+        if (xTurn) {
+            game.swapSides();
+            makeAIMove(game, xLevel, &table);
+            game.swapSides();
+        } else {
+            makeAIMove(game, oLevel, &table);
+        }
+        auto ns = chrono::duration_cast<chrono::nanoseconds>(
+            chrono::steady_clock::now() - start).count();
+        stats.latency[xTurn ? 0 : 1].record(uint64_t(ns));
+
+        char winner = game.winner();
+        if (winner == PLAYER) { stats.xWins++; break; }
+        if (winner == AI) { stats.oWins++; break; }
+        if (game.isFull()) { stats.draws++; break; }
+        xTurn = !xTurn;
+    }
+
+    stats.games++;
+    stats.nodes += searchNodes - nodesBefore;
+}
+
+// ===================================================
+// Function: runSelfPlay
+// Purpose : Plays 'games' games on 'threads' threads and prints a report
+// Output  : Win/draw/loss tallies, games/sec, nodes/sec and move
+//           latency percentiles of each side
+// Notes   : Games are handed out in batches so threads stay busy;
+//           each thread has its own table and counters. Each batch
+//           reseeds the thread's generator from (seed, batch number),
+//           so a run gives the same games for any thread count.
+// ===================================================
+void runSelfPlay(uint64_t games, int xLevel, int oLevel, int threads, uint64_t seed) {
+    static const char* LEVEL_NAMES[4] = { "", "easy", "medium", "hard" };
+    const uint64_t BATCH = 1000;
+    uint64_t batches = (games + BATCH - 1) / BATCH;
+
+    ThreadPool pool(threads);
+    vector<SelfPlayStats> perThread(pool.size());
+    vector<unique_ptr<TranspositionTable>> tables(pool.size());
+    for (auto& table : tables) table.reset(new TranspositionTable());
+
+    auto start = chrono::steady_clock::now();
+    pool.run(int(batches), [&](int batch, int worker) {
+        RUNTIME_TRACE_SCOPE("self-play batch");
+        uint64_t first = uint64_t(batch) * BATCH;
+        uint64_t count = min(BATCH, games - first);
+        rng.seed(seed, uint64_t(batch));
+        for (uint64_t g = 0; g < count; g++)
+            playSelfPlayGame(xLevel, oLevel, *tables[worker], perThread[worker]);
+    });
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    SelfPlayStats total;
+    for (const SelfPlayStats& stats : perThread) total.merge(stats);
+
+    auto share = [&](uint64_t n) { return 100.0 * double(n) / double(max<uint64_t>(total.games, 1)); };
+    cout << fixed << setprecision(2);
+    cout << "Self-play: " << total.games << " games, X = " << LEVEL_NAMES[xLevel]
+         << ", O = " << LEVEL_NAMES[oLevel] << ", " << pool.size() << " thread(s)"
+         << ", seed " << seed << "\n";
+    cout << "  X wins : " << total.xWins << " (" << share(total.xWins) << "%)\n";
+    cout << "  Draws  : " << total.draws << " (" << share(total.draws) << "%)\n";
+    cout << "  O wins : " << total.oWins << " (" << share(total.oWins) << "%)\n";
+    cout << "  Time   : " << seconds << " s, " << double(total.games) / seconds << " games/s\n";
+    cout << "  Nodes  : " << total.nodes << ", " << double(total.nodes) / seconds / 1e6
+         << " M nodes/s\n";
+    cout << "  Move latency (us)    p50      p90      p99    p99.9      max\n";
+    for (int side = 0; side < 2; side++) {
+        const LatencyHistogram& h = total.latency[side];
+        cout << "    " << (side == 0 ? "X " : "O ") << setw(6) << left
+             << LEVEL_NAMES[side == 0 ? xLevel : oLevel] << right;
+        for (double p : { 50.0, 90.0, 99.0, 99.9 })
+            cout << setw(9) << double(h.percentile(p)) / 1000.0;
+        cout << setw(9) << double(h.maximum()) / 1000.0 << "\n";
+    }
+}
+
+// Parses a difficulty given as 1-3 or easy/medium/hard (0 if invalid)
+int parseLevel(const string& text) {
+    if (text == "1" || text == "easy") return 1;
+    if (text == "2" || text == "medium") return 2;
+    if (text == "3" || text == "hard") return 3;
+    return 0;
+}
+
+// ===================================================
+// Move server
+// ---------------------------------------------------
+// Answers 3x3 move queries over TCP, for programs that used to drive
+// the console game through pipes. One thread runs an epoll event loop
+// over all sessions: a hard move takes well under a microsecond once
+// the table is warm, so a single engine and table serve every client
+// and no query waits behind a search.
+//
+// Protocol (one request per line, answers in request order):
+//   <board> [X|O] [LEVEL]
+//       board: the 9 cells A1 A2 A3 B1 ... C3 as 'X', 'O' or '.'
+//       X|O  : side to move (default: the side with fewer symbols,
+//              X when the counts are equal)
+//       LEVEL: easy, medium, hard or 1-3 (default hard)
+//       -> "MOVE B2"
+//   STATS -> "STATS <queries> <p50> <p99> <max>" (service time in us)
+//   Bad requests get "ERR <reason>" and the connection stays open.
+// ===================================================
+
+// ===================================================
+// Function: answerQuery
+// Purpose : Handles one request line of the server protocol
+// Input   :
+//   - line   : request without the line break
+//   - table  : transposition table shared by all sessions
+//   - latency: service times so far, for STATS
+// Output  : The answer line, without the line break
+// ===================================================
+string answerQuery(const string& line, TranspositionTable& table,
+                   const LatencyHistogram& latency) {
+    vector<string> tokens;
+    for (size_t pos = 0; pos < line.size();) {
+        size_t end = line.find(' ', pos);
+        if (end == string::npos) end = line.size();
+        if (end > pos) tokens.push_back(line.substr(pos, end - pos));
+        pos = end + 1;
+    }
+    if (tokens.empty()) return "ERR empty request";
+
+    if (tokens[0] == "STATS") {
+        ostringstream out;
+        out << fixed << setprecision(2) << "STATS " << latency.count()
+            << " " << double(latency.percentile(50)) / 1000.0
+            << " " << double(latency.percentile(99)) / 1000.0
+            << " " << double(latency.maximum()) / 1000.0;
+        return out.str();
+    }
+
+    const string& cells = tokens[0];
+    if (cells.size() != size_t(CELLS)) return "ERR board must have 9 cells";
+    Bitboard state;
+    for (int cell = 0; cell < CELLS; cell++) {
+        char symbol = char(toupper(cells[cell]));
+        if (symbol == PLAYER) state.player |= uint16_t(1 << cell);
+        else if (symbol == AI) state.ai |= uint16_t(1 << cell);
+        else if (symbol != '.') return "ERR cells must be X, O or .";
+    }
+
+    int xCount = popCount(state.player), oCount = popCount(state.ai);
+    char mover = (oCount < xCount) ? AI : PLAYER;
+    int difficulty = 3;
+    for (size_t i = 1; i < tokens.size(); i++) {
+        if (tokens[i] == "X" || tokens[i] == "O") mover = tokens[i][0];
+        else if (!(difficulty = parseLevel(tokens[i]))) return "ERR unknown level " + tokens[i];
+    }
+
+    int moverCount = (mover == PLAYER) ? xCount : oCount;
+    int otherCount = xCount + oCount - moverCount;
+    if (moverCount != otherCount && moverCount + 1 != otherCount)
+        return string("ERR it is not ") + mover + "'s turn";
+
+    GameState game(state);
+    if (game.winner() != ' ' || game.isFull()) return "ERR game is over";
+
+    // The AI functions play 'O'
+    if (mover == PLAYER) game.swapSides();
+    uint16_t before = game.board().ai;
+    makeAIMove(game, difficulty, &table);
+    int cell = lowestCell(uint16_t(game.board().ai & ~before));
+
+    return string("MOVE ") + char('A' + cell / SIZE) + char('1' + cell % SIZE);
+}
+
+#if defined(__linux__)
+volatile sig_atomic_t serverStopRequested = 0;
+
+void requestServerStop(int) { serverStopRequested = 1; }
+
+// ===================================================
+// Class   : MoveServer
+// Purpose : Non-blocking TCP server for answerQuery()
+// Notes   :
+//   - Level-triggered epoll; a session only asks for EPOLLOUT while it
+//     has unsent answers, so idle sessions cost nothing
+//   - Pipelined requests are answered from one read in one write
+//   - Sessions are indexed by file descriptor
+// ===================================================
+class MoveServer {
+public:
+    explicit MoveServer(uint64_t seed) : table(new TranspositionTable()) { rng.seed(seed); }
+
+    ~MoveServer() {
+        for (size_t fd = 0; fd < sessions.size(); fd++)
+            if (sessions[fd].open) close(int(fd));
+        if (epollFd >= 0) close(epollFd);
+        if (listenFd >= 0) close(listenFd);
+    }
+
+    // Serves until SIGINT/SIGTERM; returns the exit code
+    int run(int port) {
+        listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if (listenFd < 0) { perror("socket"); return 1; }
+        int yes = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons(uint16_t(port));
+        if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+            perror("bind");
+            return 1;
+        }
+        if (listen(listenFd, SOMAXCONN) < 0) { perror("listen"); return 1; }
+
+        epollFd = epoll_create1(0);
+        if (epollFd < 0) { perror("epoll_create1"); return 1; }
+        watch(listenFd, EPOLLIN, EPOLL_CTL_ADD);
+
+        struct sigaction stop = {};
+        stop.sa_handler = requestServerStop;  // No SA_RESTART: wakes epoll_wait
+        sigaction(SIGINT, &stop, nullptr);
+        sigaction(SIGTERM, &stop, nullptr);
+        signal(SIGPIPE, SIG_IGN);
+
+        cout << "Serving moves on port " << port << " (Ctrl+C to stop)\n" << flush;
+        epoll_event events[MAX_EVENTS];
+        while (!serverStopRequested) {
+            int ready = epoll_wait(epollFd, events, MAX_EVENTS, -1);
+            if (ready < 0) {
+                if (errno == EINTR) continue;
+                perror("epoll_wait");
+                return 1;
+            }
+            for (int i = 0; i < ready; i++) {
+                int fd = events[i].data.fd;
+                if (fd == listenFd) acceptSessions();
+                else handle(fd, events[i].events);
+            }
+        }
+
+        cout << fixed << setprecision(2) << "\nServed " << latency.count()
+             << " queries, service time p50 " << double(latency.percentile(50)) / 1000.0
+             << " us, p99 " << double(latency.percentile(99)) / 1000.0
+             << " us, max " << double(latency.maximum()) / 1000.0 << " us\n";
+        return 0;
+    }
+
+private:
+    static const int MAX_EVENTS = 256;
+    static const size_t MAX_LINE = 256;  // Longer requests close the session
+
+    struct Session {
+        bool open = false;
+        bool wantsWrite = false;  // Registered for EPOLLOUT
+        string input;             // Bytes after the last complete line
+        string output;            // Answers not sent yet
+    };
+
+    void watch(int fd, uint32_t events, int operation) {
+        epoll_event event = {};
+        event.events = events;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, operation, fd, &event);
+    }
+
+    void acceptSessions() {
+        while (true) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK);
+            if (fd < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) perror("accept4");
+                return;
+            }
+            int yes = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+            if (size_t(fd) >= sessions.size()) sessions.resize(size_t(fd) + 1);
+            sessions[fd] = Session();
+            sessions[fd].open = true;
+            watch(fd, EPOLLIN | EPOLLRDHUP, EPOLL_CTL_ADD);
+        }
+    }
+
+    void closeSession(int fd) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        sessions[fd] = Session();
+    }
+
+    void handle(int fd, uint32_t events) {
+        RUNTIME_TRACE_SCOPE("session event");
+        Session& session = sessions[fd];
+        if (events & (EPOLLERR | EPOLLHUP)) { closeSession(fd); return; }
+
+        if (events & (EPOLLIN | EPOLLRDHUP)) {
+            // Lines are answered after every read, so the session never
+            // buffers more than one unfinished line and one read
+            char buffer[4096];
+            while (true) {
+                ssize_t got = read(fd, buffer, sizeof(buffer));
+                if (got > 0) {
+                    session.input.append(buffer, size_t(got));
+                    if (answerLines(session)) continue;
+                    session.output += "ERR request too long\n";
+                    sendPending(fd, session);
+                    closeSession(fd);
+                    return;
+                }
+                if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+                if (got < 0 && errno == EINTR) continue;
+                // Peer closed (or failed): the complete lines are answered, drop it
+                sendPending(fd, session);
+                closeSession(fd);
+                return;
+            }
+        }
+        if (!sendPending(fd, session)) closeSession(fd);
+    }
+
+    // Answers every complete line of session.input; false if a line, or the
+    // unfinished rest, is longer than MAX_LINE (lines before it are answered)
+    bool answerLines(Session& session) {
+        size_t start = 0;
+        for (size_t end; (end = session.input.find('\n', start)) != string::npos; start = end + 1) {
+            size_t length = end - start;
+            if (length > 0 && session.input[end - 1] == '\r') length--;  // Telnet-style CRLF
+            if (length > MAX_LINE) {
+                session.input.erase(0, start);
+                return false;
+            }
+            auto begin = chrono::steady_clock::now();
+            session.output += answerQuery(session.input.substr(start, length), *table, latency);
+            session.output += '\n';
+            latency.record(uint64_t(chrono::duration_cast<chrono::nanoseconds>(
+                chrono::steady_clock::now() - begin).count()));
+        }
+        session.input.erase(0, start);
+        return session.input.size() <= MAX_LINE;
+    }
+
+    // Sends what the socket accepts; false if the connection failed
+    bool sendPending(int fd, Session& session) {
+        size_t sent = 0;
+        while (sent < session.output.size()) {
+            ssize_t n = send(fd, session.output.data() + sent, session.output.size() - sent, MSG_NOSIGNAL);
+            if (n > 0) { sent += size_t(n); continue; }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            return false;
+        }
+        session.output.erase(0, sent);
+
+        bool pending = !session.output.empty();
+        if (pending != session.wantsWrite) {
+            session.wantsWrite = pending;
+            watch(fd, EPOLLIN | EPOLLRDHUP | (pending ? uint32_t(EPOLLOUT) : 0u), EPOLL_CTL_MOD);
+        }
+        return true;
+    }
+
+    unique_ptr<TranspositionTable> table;  // Shared by all sessions
+    LatencyHistogram latency;
+    vector<Session> sessions;
+    int listenFd = -1;
+    int epollFd = -1;
+};
+#endif
+
+// ===================================================
+// Function: runServer
+// Purpose : Starts the move server on 'port' (see "Move server" above)
+// Output  : Exit code for main()
+// ===================================================
+int runServer(int port, uint64_t seed) {
+#if defined(__linux__)
+    MoveServer server(seed);
+    return server.run(port);
+#else
+    (void)port;
+    (void)seed;
+    cerr << "Server mode needs Linux (epoll)\n";
+    return 1;
+#endif
+}
+
+// ===================================================
+// Class   : TraceSession
+// Purpose : Records a Chrome trace (--trace FILE) while it exists
+// Notes   : Does nothing with an empty path. The file is written
+//           when main() returns, whichever mode ran.
+// ===================================================
+class TraceSession {
+public:
+    explicit TraceSession(const string& path) : path(path) {
+        if (path.empty()) return;
+        runtime::trace::setThreadName("main");
+        runtime::trace::start();
+    }
+
+    ~TraceSession() {
+        if (path.empty()) return;
+        if (runtime::trace::stop(path)) cout << "Trace written to " << path << "\n";
+        else cerr << "Could not write trace: " << path << "\n";
+    }
+
+private:
+    string path;
+};
+
+// ===================================================
+// Function: main
+// Purpose : Entry point of the program
+// Behavior:
+//   - Without arguments, calls playGame() to start a 3x3 match
+//   - --size N --k K plays the N×N variant with K in a row
+//     (3x3, 4x4 with 3 or 4, 5x5 with 4 or 5)
+//   - --time MS sets the hard AI's time per move on those boards
+//   - --threads T sets the hard AI's search threads on those boards
+//   - --selfplay GAMES [--x LEVEL] [--o LEVEL] plays 3x3 AI against AI
+//     without input and prints a benchmark report (LEVEL: easy, medium,
+//     hard or 1-3; --threads defaults to all cores here)
+//   - --server PORT serves 3x3 moves over TCP until Ctrl+C
+//   - --seed S fixes the random moves (default: current time)
+//   - --trace FILE writes a Chrome trace of the run (see runtime/trace.h)
+//   - --solve FILE [--plies P] [--depth D] solves the positions of the
+//     --size/--k board with up to P symbols (default 4) to depth D
+//     (default: to the end) and writes a position database;
+//     --db FILE lets the hard AI play from one (see PositionDatabase)
+// ===================================================
+int main(int argc, char* argv[]) {
+    int size = 3, k = 0, threads = 0;
+    double budgetMs = 1000;
+    uint64_t selfPlayGames = 0;
+    int serverPort = 0;
+    int xLevel = 3, oLevel = 3;
+    uint64_t seed = uint64_t(time(0));
+    string tracePath, solvePath, dbPath;
+    int solvePlies = 4, solveDepth = 0;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--size" && i + 1 < argc) size = atoi(argv[++i]);
+        else if (arg == "--k" && i + 1 < argc) k = atoi(argv[++i]);
+        else if (arg == "--time" && i + 1 < argc) budgetMs = atof(argv[++i]);
+        else if (arg == "--threads" && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (arg == "--selfplay" && i + 1 < argc) selfPlayGames = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--x" && i + 1 < argc) xLevel = parseLevel(argv[++i]);
+        else if (arg == "--o" && i + 1 < argc) oLevel = parseLevel(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc) seed = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--server" && i + 1 < argc) serverPort = atoi(argv[++i]);
+        else if (arg == "--trace" && i + 1 < argc) tracePath = argv[++i];
+        else if (arg == "--solve" && i + 1 < argc) solvePath = argv[++i];
+        else if (arg == "--plies" && i + 1 < argc) solvePlies = atoi(argv[++i]);
+        else if (arg == "--depth" && i + 1 < argc) solveDepth = atoi(argv[++i]);
+        else if (arg == "--db" && i + 1 < argc) dbPath = argv[++i];
+        else {
+            cerr << "Usage: " << argv[0] << " [--size N] [--k K] [--time MS] [--threads T] [--seed S] [--db FILE]\n"
+                 << "       " << argv[0] << " --solve FILE --size N [--k K] [--plies P] [--depth D] [--threads T]\n"
+                 << "       " << argv[0] << " --selfplay GAMES [--x LEVEL] [--o LEVEL] [--threads T] [--seed S]\n"
+                 << "       " << argv[0] << " --server PORT [--seed S]\n"
+                 << "  every mode: [--trace FILE.json]\n";
+            return 1;
+        }
+    }
+    if (k == 0) k = size;
+    TraceSession trace(tracePath);
+
+    if (serverPort != 0) {
+        if (serverPort < 0 || serverPort > 65535) {
+            cerr << "PORT must be 1-65535\n";
+            return 1;
+        }
+        return runServer(serverPort, seed);
+    }
+
+    if (selfPlayGames > 0) {
+        if (xLevel == 0 || oLevel == 0) {
+            cerr << "LEVEL must be easy, medium, hard or 1-3\n";
+            return 1;
+        }
+        if (threads <= 0) threads = max(1, int(thread::hardware_concurrency()));
+        runSelfPlay(selfPlayGames, xLevel, oLevel, threads, seed);
+        return 0;
+    }
+
+    if (!solvePath.empty()) {
+        if (threads <= 0) threads = max(1, int(thread::hardware_concurrency()));
+        if (size == 4 && k == 3) return solvePositionsNK<4, 3>(solvePath, solvePlies, solveDepth, threads);
+        if (size == 4 && k == 4) return solvePositionsNK<4, 4>(solvePath, solvePlies, solveDepth, threads);
+        if (size == 5 && k == 4) return solvePositionsNK<5, 4>(solvePath, solvePlies, solveDepth, threads);
+        if (size == 5 && k == 5) return solvePositionsNK<5, 5>(solvePath, solvePlies, solveDepth, threads);
+        cerr << "--solve needs a 4x4 or 5x5 board (the 3x3 game has -DTTT_OPENING_BOOK)\n";
+        return 1;
+    }
+    if (threads <= 0) threads = 1;
+
+    bool ok = true;
+    if (size == 3 && k == 3 && dbPath.empty()) playGame(seed);
+    else if (size == 4 && k == 3) ok = playGameNK<4, 3>(budgetMs, threads, seed, dbPath);
+    else if (size == 4 && k == 4) ok = playGameNK<4, 4>(budgetMs, threads, seed, dbPath);
+    else if (size == 5 && k == 4) ok = playGameNK<5, 4>(budgetMs, threads, seed, dbPath);
+    else if (size == 5 && k == 5) ok = playGameNK<5, 5>(budgetMs, threads, seed, dbPath);
+    else {
+        cerr << "Unsupported board: " << size << "x" << size << " with " << k << " in a row"
+             << (size == 3 && k == 3 ? " and --db" : "") << "\n";
+        return 1;
+    }
+    return ok ? 0 : 1;
 }
@@ -0,0 +1,127 @@
+// Shared runtime: arena allocators for per-frame and per-search scratch memory.
+//
+// - Arena: bump allocator over a list of blocks. Allocating is an aligned
+//   pointer increment; nothing is freed one by one. reset() (or an ArenaScope
+//   ending) makes the memory reusable while keeping the blocks, so a loop that
+//   needs about the same scratch every iteration stops calling malloc once the
+//   first iterations have grown the arena.
+// - threadArena(): one arena per thread, so workers never share or lock one.
+// - ArenaScope: remembers the arena's position and rewinds to it on destruction,
+//   so nested functions can use the same thread arena.
+// - ArenaAllocator<T>: lets standard containers (ArenaVector<T>) allocate from an
+//   arena. Growing a vector leaves its old buffer in the arena until the rewind,
+//   so reserve() what is known up front.
+// Objects in an arena are not destroyed by it: use it for trivially destructible
+// data, or for containers that are destroyed before the scope ends.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace runtime {
+
+class Arena {
+public:
+    // Position of an arena, for rewind()
+    struct Mark {
+        size_t block;
+        size_t offset;
+    };
+
+    explicit Arena(size_t blockSize = 64 * 1024) : blockSize(blockSize) {}
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Returns 'bytes' bytes aligned to 'alignment' (a power of two).
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+        if (current < blocks.size()) {
+            char* base = blocks[current].data.get();
+            uintptr_t address = (reinterpret_cast<uintptr_t>(base) + offset + alignment - 1) & ~uintptr_t(alignment - 1);
+            size_t start = size_t(address - reinterpret_cast<uintptr_t>(base));
+            if (start + bytes <= blocks[current].size) {
+                offset = start + bytes;
+                return base + start;
+            }
+        }
+        return allocateSlow(bytes, alignment);
+    }
+
+    template <typename T>
+    T* allocateArray(size_t count) {
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    Mark mark() const { return Mark{ current, offset }; }
+    void rewind(const Mark& to) {
+        current = to.block;
+        offset = to.offset;
+    }
+    void reset() { rewind(Mark()); }
+
+    // Bytes in all blocks (what the arena holds on to between resets)
+    size_t capacity() const;
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size = 0;
+    };
+
+    void* allocateSlow(size_t bytes, size_t alignment);
+
+    const size_t blockSize;
+    std::vector<Block> blocks;
+    size_t current = 0;  // Block being filled
+    size_t offset = 0;   // Bytes used in it
+};
+
+// The calling thread's arena (created on first use).
+Arena& threadArena();
+
+// Rewinds 'arena' to where it was when the scope began.
+class ArenaScope {
+public:
+    explicit ArenaScope(Arena& arena) : arena(arena), start(arena.mark()) {}
+    ~ArenaScope() { arena.rewind(start); }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+    Arena& get() const { return arena; }
+
+private:
+    Arena& arena;
+    const Arena::Mark start;
+};
+
+template <typename T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+
+    ArenaAllocator(Arena& arena) : arena(&arena) {}
+    ArenaAllocator(const ArenaScope& scope) : arena(&scope.get()) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.source()) {}
+
+    T* allocate(size_t count) { return arena->allocateArray<T>(count); }
+    void deallocate(T*, size_t) {}
+
+    Arena* source() const { return arena; }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.source(); }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.source(); }
+
+private:
+    Arena* arena;
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+}  // namespace runtime
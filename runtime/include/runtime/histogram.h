@@ -0,0 +1,136 @@
+// Shared runtime: log-scale histograms for latency percentiles.
+//
+// - Histogram<SUB>: counts integer samples (the unit is the caller's, e.g.
+//   nanoseconds or microseconds) in SUB buckets per power of two, so a
+//   percentile is within 1/SUB of the real sample and recording is O(1).
+//   Samples below SUB are exact.
+// - record() uses relaxed atomics: any number of threads can record into one
+//   histogram without a lock, and a reporter can take snapshot()s meanwhile.
+// - Snapshot: the counts at one moment. since() gives the samples between two
+//   snapshots (one report interval); merge() adds another histogram's samples.
+// Memory: (65 - log2(SUB)) * SUB counters of 8 bytes, e.g. 8 KB for SUB = 16.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace runtime {
+
+template <int SUB = 16>
+class Histogram {
+    static_assert(SUB >= 2 && (SUB & (SUB - 1)) == 0, "SUB must be a power of two");
+
+    static constexpr int floorLog2(uint64_t x) {
+        int e = 0;
+        while (x >>= 1) e++;
+        return e;
+    }
+
+public:
+    static constexpr int SHIFT = floorLog2(SUB);
+    static constexpr int BUCKETS = (65 - SHIFT) * SUB;
+
+    // Counts at one moment; the difference of two is one interval.
+    struct Snapshot {
+        std::vector<uint64_t> counts = std::vector<uint64_t>(BUCKETS);
+        uint64_t total = 0;
+        uint64_t sum = 0;
+        uint64_t largest = 0;  // Largest sample up to this moment
+
+        // Samples recorded after 'before'. 'largest' stays the overall one,
+        // which bounds the interval's largest sample from above.
+        Snapshot since(const Snapshot& before) const {
+            Snapshot result;
+            for (int b = 0; b < BUCKETS; b++) result.counts[b] = counts[b] - before.counts[b];
+            result.total = total - before.total;
+            result.sum = sum - before.sum;
+            result.largest = largest;
+            return result;
+        }
+
+        void merge(const Snapshot& other) {
+            for (int b = 0; b < BUCKETS; b++) counts[b] += other.counts[b];
+            total += other.total;
+            sum += other.sum;
+            largest = std::max(largest, other.largest);
+        }
+
+        double mean() const { return total ? double(sum) / double(total) : 0.0; }
+
+        // Returns the p-th percentile (0-100): the upper edge of its bucket,
+        // at most the largest sample. 0 without samples.
+        uint64_t percentile(double p) const {
+            uint64_t rank = uint64_t(p / 100.0 * double(total)), seen = 0;
+            for (int b = 0; b < BUCKETS; b++) {
+                seen += counts[b];
+                if (seen > rank) return std::min(bucketValue(b), largest);
+            }
+            return total ? largest : 0;
+        }
+    };
+
+    Histogram() = default;
+    Histogram(const Histogram&) = delete;
+    Histogram& operator=(const Histogram&) = delete;
+
+    void record(uint64_t value) {
+        counts[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+        samples.fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(value, std::memory_order_relaxed);
+        uint64_t seen = largest.load(std::memory_order_relaxed);
+        while (value > seen && !largest.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Adds the samples of 'other' (e.g. another thread's histogram).
+    void merge(const Histogram& other) {
+        for (int b = 0; b < BUCKETS; b++) {
+            counts[b].fetch_add(other.counts[b].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        samples.fetch_add(other.samples.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        sum.fetch_add(other.sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        uint64_t value = other.largest.load(std::memory_order_relaxed);
+        uint64_t seen = largest.load(std::memory_order_relaxed);
+        while (value > seen && !largest.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    Snapshot snapshot() const {
+        Snapshot result;
+        for (int b = 0; b < BUCKETS; b++) {
+            result.counts[b] = counts[b].load(std::memory_order_relaxed);
+            result.total += result.counts[b];  // From the counts, so percentiles see a consistent total
+        }
+        result.sum = sum.load(std::memory_order_relaxed);
+        result.largest = largest.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    uint64_t count() const { return samples.load(std::memory_order_relaxed); }
+    uint64_t maximum() const { return largest.load(std::memory_order_relaxed); }
+    uint64_t percentile(double p) const { return snapshot().percentile(p); }
+
+    static int bucketOf(uint64_t value) {
+        if (value < uint64_t(SUB)) return int(value);
+        int e = floorLog2(value);  // >= SHIFT
+        return SUB + (e - SHIFT) * SUB + int((value >> (e - SHIFT)) - SUB);
+    }
+
+    // Upper edge of bucket b (the top bucket's wraps to UINT64_MAX)
+    static uint64_t bucketValue(int b) {
+        if (b < SUB) return uint64_t(b);
+        int e = (b - SUB) / SUB + SHIFT;
+        uint64_t mantissa = SUB + (b - SUB) % SUB;
+        return ((mantissa + 1) << (e - SHIFT)) - 1;
+    }
+
+private:
+    std::atomic<uint64_t> counts[BUCKETS] = {};
+    std::atomic<uint64_t> samples{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> largest{0};
+};
+
+}  // namespace runtime
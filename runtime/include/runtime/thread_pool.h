@@ -0,0 +1,73 @@
+// Shared runtime: work-stealing thread pool for fork-join loops.
+//
+// pool.run(count, fn) calls fn(task, worker) for every task in 0..count-1
+// and returns once all of them are done. The calling thread works as
+// worker 0, so a pool of size 1 starts no threads at all.
+//
+// Tasks are dealt out round-robin (worker w starts with tasks w, w + size,
+// w + 2 * size, ...), so every worker begins with the first tasks, which
+// callers put first because they matter most (e.g. the best root moves).
+// Each worker takes its own tasks from the front; a worker that runs out
+// steals the back half of the largest remaining share of another worker.
+// A share is one 64-bit word (begin and end), so taking a task or stealing
+// is a single compare-and-swap, and uneven tasks still keep every thread busy.
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace runtime {
+
+class ThreadPool {
+public:
+    explicit ThreadPool(int threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return workerCount; }
+
+    // Runs fn(task, worker) for task = 0..count-1 on all workers and waits for them.
+    // Not reentrant: fn must not call run() on the same pool.
+    void run(int count, const std::function<void(int, int)>& fn);
+
+    // Tasks taken from other workers' shares since the pool was made (for reports).
+    uint64_t steals() const { return stolen.load(std::memory_order_relaxed); }
+
+private:
+    // A worker's remaining share: positions [begin, end) of the round-robin order
+    struct alignas(64) Share {
+        std::atomic<uint64_t> range{0};
+    };
+
+    static uint64_t pack(uint32_t begin, uint32_t end) { return uint64_t(end) << 32 | begin; }
+    static uint32_t beginOf(uint64_t range) { return uint32_t(range); }
+    static uint32_t endOf(uint64_t range) { return uint32_t(range >> 32); }
+
+    void workerLoop(int worker);
+    void work(int worker);
+    bool takeOwn(int worker, uint32_t& position);
+    bool steal(int worker);
+
+    const int workerCount;
+    std::vector<std::thread> workers;
+    std::unique_ptr<Share[]> shares;
+    std::mutex mtx;
+    std::condition_variable wake, finished;
+    const std::function<void(int, int)>* job = nullptr;
+    int jobCount = 0;
+    uint32_t perWorker = 0;  // Positions per share: worker w starts with [w * perWorker, (w + 1) * perWorker)
+    int busy = 0;
+    uint64_t generation = 0;
+    bool stopping = false;
+    std::atomic<uint64_t> stolen{0};
+};
+
+}  // namespace runtime
@@ -0,0 +1,83 @@
+// Shared runtime: low-overhead tracing, exported in the Chrome trace format.
+//
+// Spans ("X" events), counters ("C") and instant events ("i") are recorded
+// into a buffer per thread and written as one JSON file by stop(), which
+// chrome://tracing and ui.perfetto.dev open directly.
+// - Until start() is called nothing is recorded, and a Scope costs one relaxed
+//   atomic load. While tracing, an event takes an uncontended lock of its
+//   thread's buffer (stop() may read it from another thread) and 40 bytes;
+//   a thread keeps at most 2^20 events (40 MB) per trace and drops the rest.
+// - Names are not copied: pass string literals, or intern() other strings once.
+// - Times are nanoseconds of std::chrono::steady_clock; the file shows them
+//   relative to start().
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace runtime {
+namespace trace {
+
+extern std::atomic<bool> active;
+
+inline bool enabled() { return active.load(std::memory_order_relaxed); }
+
+inline int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Starts recording (and forgets the events of an earlier trace).
+void start();
+
+// Stops recording and writes the events to 'path'. Returns false if the file cannot be written.
+bool stop(const std::string& path);
+
+// Names the calling thread in the trace ("detect worker", ...). Copied; may be called before start().
+void setThreadName(const std::string& name);
+
+// Returns a copy of 'name' that lives until the process ends, for names built at run time.
+const char* intern(const std::string& name);
+
+// A span of the calling thread from beginNs to endNs.
+void complete(const char* name, int64_t beginNs, int64_t endNs);
+
+// A span that ended now and took 'ms' milliseconds (for stages that already measure themselves).
+inline void completeMs(const char* name, double ms) {
+    if (!enabled()) return;
+    int64_t end = nowNs();
+    complete(name, end - int64_t(ms * 1e6), end);
+}
+
+// The value of a counter track (queue depth, nodes per second, ...) at this moment.
+void counter(const char* name, double value);
+
+// A point in time on the calling thread's track.
+void instant(const char* name);
+
+// Records a span from its construction to the end of the scope.
+class Scope {
+public:
+    explicit Scope(const char* spanName) : name(enabled() ? spanName : nullptr), begin(name ? nowNs() : 0) {}
+    ~Scope() {
+        if (name) complete(name, begin, nowNs());
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    const char* const name;
+    const int64_t begin;
+};
+
+}  // namespace trace
+}  // namespace runtime
+
+#define RUNTIME_TRACE_CONCAT2(a, b) a##b
+#define RUNTIME_TRACE_CONCAT(a, b) RUNTIME_TRACE_CONCAT2(a, b)
+
+// Traces the rest of the enclosing scope as a span called 'name'.
+#define RUNTIME_TRACE_SCOPE(name) ::runtime::trace::Scope RUNTIME_TRACE_CONCAT(traceScope, __LINE__)(name)
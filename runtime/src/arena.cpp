@@ -0,0 +1,34 @@
+// Shared runtime: arena allocator (see arena.h).
+#include "runtime/arena.h"
+
+#include <algorithm>
+
+namespace runtime {
+
+void* Arena::allocateSlow(size_t bytes, size_t alignment) {
+    // Move on to the next block that is large enough; blocks too small for this request are skipped
+    for (current = blocks.empty() ? 0 : current + 1; current < blocks.size(); current++) {
+        if (blocks[current].size >= bytes + alignment) break;
+    }
+    if (current == blocks.size()) {
+        Block block;
+        block.size = std::max(blockSize, bytes + alignment);
+        block.data.reset(new char[block.size]);
+        blocks.push_back(std::move(block));
+    }
+    offset = 0;
+    return allocate(bytes, alignment);
+}
+
+size_t Arena::capacity() const {
+    size_t total = 0;
+    for (const Block& block : blocks) total += block.size;
+    return total;
+}
+
+Arena& threadArena() {
+    thread_local Arena arena;
+    return arena;
+}
+
+}  // namespace runtime
@@ -0,0 +1,115 @@
+// Shared runtime: work-stealing thread pool (see thread_pool.h).
+#include "runtime/thread_pool.h"
+
+#include <algorithm>
+
+#include "runtime/trace.h"
+
+namespace runtime {
+
+ThreadPool::ThreadPool(int threads)
+    : workerCount(std::max(1, threads)), shares(new Share[size_t(std::max(1, threads))]) {
+    for (int w = 1; w < workerCount; w++)
+        workers.emplace_back([this, w] { workerLoop(w); });
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& t : workers) t.join();
+}
+
+void ThreadPool::run(int count, const std::function<void(int, int)>& fn) {
+    if (count <= 0) return;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        job = &fn;
+        jobCount = count;
+        perWorker = uint32_t((count + workerCount - 1) / workerCount);
+        for (int w = 0; w < workerCount; w++)
+            shares[w].range.store(pack(uint32_t(w) * perWorker, uint32_t(w + 1) * perWorker),
+                                  std::memory_order_relaxed);
+        busy = workerCount - 1;
+        generation++;
+    }
+    wake.notify_all();
+    work(0);
+
+    std::unique_lock<std::mutex> lock(mtx);
+    finished.wait(lock, [this] { return busy == 0; });
+    job = nullptr;
+}
+
+void ThreadPool::workerLoop(int worker) {
+    trace::setThreadName("pool worker");
+    uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+        work(worker);
+        std::lock_guard<std::mutex> lock(mtx);
+        if (--busy == 0) finished.notify_one();
+    }
+}
+
+void ThreadPool::work(int worker) {
+    uint32_t position;
+    do {
+        while (takeOwn(worker, position)) {
+            // Position p of share s is the (p % perWorker)-th task of worker s in round-robin order
+            int task = int(position % perWorker) * workerCount + int(position / perWorker);
+            if (task < jobCount) (*job)(task, worker);
+        }
+    } while (steal(worker));
+}
+
+bool ThreadPool::takeOwn(int worker, uint32_t& position) {
+    std::atomic<uint64_t>& range = shares[worker].range;
+    uint64_t current = range.load(std::memory_order_acquire);
+    while (beginOf(current) < endOf(current)) {
+        if (range.compare_exchange_weak(current, pack(beginOf(current) + 1, endOf(current)),
+                                        std::memory_order_acq_rel)) {
+            position = beginOf(current);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Moves the back half of the largest other share into this worker's (empty) share.
+bool ThreadPool::steal(int worker) {
+    while (true) {
+        int victim = -1;
+        uint32_t largest = 0;
+        for (int k = 1; k < workerCount; k++) {
+            int other = (worker + k) % workerCount;
+            uint64_t range = shares[other].range.load(std::memory_order_acquire);
+            uint32_t left = endOf(range) - std::min(beginOf(range), endOf(range));
+            if (left > largest) {
+                largest = left;
+                victim = other;
+            }
+        }
+        if (victim < 0) return false;
+
+        std::atomic<uint64_t>& range = shares[victim].range;
+        uint64_t current = range.load(std::memory_order_acquire);
+        uint32_t begin = beginOf(current), end = endOf(current);
+        if (begin >= end) continue;  // Emptied meanwhile: look again
+        uint32_t middle = end - (end - begin + 1) / 2;
+        if (range.compare_exchange_strong(current, pack(begin, middle), std::memory_order_acq_rel)) {
+            shares[worker].range.store(pack(middle, end), std::memory_order_release);
+            stolen.fetch_add(end - middle, std::memory_order_relaxed);
+            return true;
+        }
+    }
+}
+
+}  // namespace runtime
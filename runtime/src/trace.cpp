@@ -0,0 +1,168 @@
+// Shared runtime: tracing and the Chrome trace exporter (see trace.h).
+#include "runtime/trace.h"
+
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace runtime {
+namespace trace {
+
+std::atomic<bool> active{false};
+
+namespace {
+
+struct Event {
+    const char* name;
+    int64_t begin;   // Nanoseconds
+    int64_t end;     // Spans only
+    double value;    // Counters only
+    char phase;      // 'X', 'C' or 'i'
+};
+
+// The events of one thread. Owned by the registry, so they outlive the thread.
+struct ThreadBuffer {
+    std::mutex lock;
+    std::vector<Event> events;
+    std::string name;
+    int id = 0;
+};
+
+struct Registry {
+    std::mutex lock;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::deque<std::string> names;  // intern(): a deque never moves its elements
+    int64_t startNs = 0;
+};
+
+Registry& registry() {
+    static Registry* instance = new Registry();  // Never destroyed: threads may trace during exit
+    return *instance;
+}
+
+ThreadBuffer& threadBuffer() {
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> guard(r.lock);
+        r.buffers.emplace_back(new ThreadBuffer());
+        buffer = r.buffers.back().get();
+        buffer->id = int(r.buffers.size());
+    }
+    return *buffer;
+}
+
+const size_t MAX_EVENTS = size_t(1) << 20;  // Per thread and trace
+
+void add(const Event& event) {
+    ThreadBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> guard(buffer.lock);
+    if (buffer.events.size() < MAX_EVENTS) buffer.events.push_back(event);
+}
+
+// Writes 'text' as a JSON string
+void writeString(std::ostream& out, const char* text) {
+    out << '"';
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') out << '\\' << *c;
+        else if (static_cast<unsigned char>(*c) < 0x20) out << ' ';
+        else out << *c;
+    }
+    out << '"';
+}
+
+// Microseconds since start() with nanosecond digits, as the format expects
+void writeMicros(std::ostream& out, int64_t ns) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.3f", double(ns) / 1000.0);
+    out << text;
+}
+
+}  // namespace
+
+void start() {
+    Registry& r = registry();
+    {
+        std::lock_guard<std::mutex> guard(r.lock);
+        for (auto& buffer : r.buffers) {
+            std::lock_guard<std::mutex> bufferGuard(buffer->lock);
+            buffer->events.clear();
+        }
+        r.startNs = nowNs();
+    }
+    active.store(true, std::memory_order_relaxed);
+}
+
+bool stop(const std::string& path) {
+    active.store(false, std::memory_order_relaxed);
+    std::ofstream out(path);
+    if (!out) return false;
+
+    Registry& r = registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (auto& buffer : r.buffers) {
+        std::lock_guard<std::mutex> bufferGuard(buffer->lock);
+        if (!buffer->name.empty()) {
+            out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id
+                << ",\"args\":{\"name\":";
+            writeString(out, buffer->name.c_str());
+            out << "}}";
+            first = false;
+        }
+        for (const Event& event : buffer->events) {
+            if (event.begin < r.startNs) continue;  // Began before start()
+            out << (first ? "" : ",\n") << "{\"name\":";
+            writeString(out, event.name);
+            out << ",\"ph\":\"" << event.phase << "\",\"pid\":1,\"tid\":" << buffer->id << ",\"ts\":";
+            writeMicros(out, event.begin - r.startNs);
+            if (event.phase == 'X') {
+                out << ",\"dur\":";
+                writeMicros(out, event.end - event.begin);
+            } else if (event.phase == 'C') {
+                out << ",\"args\":{\"value\":" << event.value << "}";
+            } else {
+                out << ",\"s\":\"t\"";
+            }
+            out << "}";
+            first = false;
+        }
+        buffer->events.clear();
+    }
+    out << "\n]}\n";
+    return bool(out);
+}
+
+void setThreadName(const std::string& name) {
+    ThreadBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> guard(buffer.lock);
+    buffer.name = name;
+}
+
+const char* intern(const std::string& name) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    for (const std::string& known : r.names)
+        if (known == name) return known.c_str();
+    r.names.push_back(name);
+    return r.names.back().c_str();
+}
+
+void complete(const char* name, int64_t beginNs, int64_t endNs) {
+    if (enabled()) add(Event{ name, beginNs, endNs, 0.0, 'X' });
+}
+
+void counter(const char* name, double value) {
+    if (enabled()) add(Event{ name, nowNs(), 0, value, 'C' });
+}
+
+void instant(const char* name) {
+    if (enabled()) add(Event{ name, nowNs(), 0, 0.0, 'i' });
+}
+
+}  // namespace trace
+}  // namespace runtime
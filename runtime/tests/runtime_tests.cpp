@@ -0,0 +1,325 @@
+// Tests of the shared runtime: the thread pool runs every task exactly once
+// under contention, arena scopes rewind to where they began, the trace
+// exporter writes the events of every thread, and histograms keep every
+// sample within their bucket error. Run by ctest (runtime_tests).
+#include "runtime/arena.h"
+#include "runtime/histogram.h"
+#include "runtime/thread_pool.h"
+#include "runtime/trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": " #condition "\n";   \
+            failures++;                                                         \
+        }                                                                       \
+    } while (0)
+
+// Every index once, from valid workers, for task counts around the pool size
+// and with uneven tasks, so that workers run out early and steal.
+void testPoolRunsEveryTaskOnce() {
+    for (int threads : { 1, 2, 3, 4, 8 }) {
+        runtime::ThreadPool pool(threads);
+        CHECK(pool.size() == threads);
+        for (int count : { 0, 1, threads - 1, threads, threads + 1, 97, 5000 }) {
+            for (int round = 0; round < 20; round++) {
+                std::vector<std::atomic<int>> runs(size_t(count) + 1);
+                std::atomic<bool> badWorker{false};
+                pool.run(count, [&](int task, int worker) {
+                    if (worker < 0 || worker >= pool.size()) badWorker = true;
+                    runs[size_t(task)].fetch_add(1, std::memory_order_relaxed);
+                    // A few slow tasks at the start of some shares leave the rest to thieves
+                    if (task % 61 == 0) std::this_thread::sleep_for(std::chrono::microseconds(200));
+                });
+                int wrong = 0;
+                for (int i = 0; i < count; i++) wrong += runs[size_t(i)].load() != 1;
+                CHECK(wrong == 0);
+                CHECK(!badWorker);
+            }
+        }
+    }
+}
+
+// A single slow worker share must be stolen from, not waited for.
+void testPoolStealsFromSlowWorker() {
+    runtime::ThreadPool pool(4);
+    std::atomic<int> done{0};
+    pool.run(4000, [&](int task, int) {
+        if (task % 4 == 0) std::this_thread::sleep_for(std::chrono::microseconds(50));  // Worker 0's share
+        done++;
+    });
+    CHECK(done.load() == 4000);
+    CHECK(pool.steals() > 0);
+}
+
+// The calling thread is worker 0, so the pool can be driven from several
+// threads in turn, and results written per worker need no locks.
+void testPoolPerWorkerState() {
+    runtime::ThreadPool pool(4);
+    std::vector<uint64_t> sums(size_t(pool.size()), 0);
+    pool.run(10000, [&](int task, int worker) { sums[size_t(worker)] += uint64_t(task); });
+    uint64_t total = 0;
+    for (uint64_t sum : sums) total += sum;
+    CHECK(total == uint64_t(9999) * 10000 / 2);
+}
+
+void testArenaScopeRewinds() {
+    runtime::Arena arena(1024);
+    char* outer = static_cast<char*>(arena.allocate(100));
+    memset(outer, 'o', 100);
+
+    char* firstInner;
+    {
+        runtime::ArenaScope scope(arena);
+        firstInner = static_cast<char*>(arena.allocate(200));
+        memset(firstInner, 'i', 200);
+        {
+            runtime::ArenaScope nested(arena);
+            arena.allocate(4000);  // Spills into a second block
+            CHECK(arena.capacity() > 1024);
+        }
+        // The nested scope gave back its block position, not this scope's memory
+        char* next = static_cast<char*>(arena.allocate(8));
+        CHECK(next >= firstInner + 200);
+    }
+    // Memory from before the scope is untouched, and the scope's memory is reused
+    char* again = static_cast<char*>(arena.allocate(200));
+    CHECK(again == firstInner);
+    bool outerIntact = true;
+    for (int i = 0; i < 100; i++) outerIntact &= outer[i] == 'o';
+    CHECK(outerIntact);
+
+    // Once the first round has grown the arena, the same work keeps its blocks
+    size_t capacity = 0;
+    for (int round = 0; round < 10; round++) {
+        {
+            runtime::ArenaScope scope(arena);
+            arena.allocate(4000);
+            arena.allocate(300);
+        }
+        if (round == 0) capacity = arena.capacity();
+    }
+    CHECK(arena.capacity() == capacity);
+
+    arena.reset();
+    CHECK(arena.allocate(100) == outer);
+}
+
+void testArenaAlignment() {
+    runtime::Arena arena(256);
+    for (size_t alignment : { 1, 2, 8, 16, 64 }) {
+        arena.allocate(3, 1);
+        void* p = arena.allocate(24, alignment);
+        CHECK(reinterpret_cast<uintptr_t>(p) % alignment == 0);
+    }
+    void* large = arena.allocate(10000, 64);  // Larger than a block
+    CHECK(reinterpret_cast<uintptr_t>(large) % 64 == 0);
+}
+
+void testArenaVector() {
+    runtime::Arena& arena = runtime::threadArena();
+    runtime::Arena::Mark before = arena.mark();
+    {
+        runtime::ArenaScope scope(arena);
+        runtime::ArenaVector<int> values(scope);
+        values.reserve(16);
+        for (int i = 0; i < 1000; i++) values.push_back(i);  // Grows past the reserve
+        bool ordered = true;
+        for (int i = 0; i < 1000; i++) ordered &= values[size_t(i)] == i;
+        CHECK(ordered);
+    }
+    runtime::Arena::Mark after = arena.mark();
+    CHECK(after.block == before.block && after.offset == before.offset);
+}
+
+size_t countOf(const std::string& text, const std::string& what) {
+    size_t count = 0;
+    for (size_t at = text.find(what); at != std::string::npos; at = text.find(what, at + 1)) count++;
+    return count;
+}
+
+void testTraceWritesEveryThread() {
+    const int THREADS = 4, SPANS = 1000;
+    std::string path = "runtime_tests_trace.json";
+
+    runtime::trace::complete("before start", 0, 1);  // Not recorded
+    runtime::trace::start();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++)
+        threads.emplace_back([t]() {
+            runtime::trace::setThreadName("tester " + std::to_string(t));
+            for (int i = 0; i < SPANS; i++) {
+                RUNTIME_TRACE_SCOPE("span");
+            }
+            runtime::trace::counter("count", t);
+        });
+    for (std::thread& thread : threads) thread.join();
+    CHECK(runtime::trace::stop(path));
+    runtime::trace::complete("after stop", 0, 1);  // Not recorded
+
+    std::ifstream in(path);
+    std::stringstream text;
+    text << in.rdbuf();
+    std::string json = text.str();
+    const std::string header = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    CHECK(json.compare(0, header.size(), header) == 0);
+    CHECK(countOf(json, "\"name\":\"span\",\"ph\":\"X\"") == size_t(THREADS * SPANS));
+    CHECK(countOf(json, "\"ph\":\"C\"") == size_t(THREADS));
+    CHECK(countOf(json, "\"name\":\"thread_name\"") >= size_t(THREADS));
+    CHECK(countOf(json, "before start") == 0 && countOf(json, "after stop") == 0);
+    std::remove(path.c_str());
+}
+
+// Every value falls in a bucket whose upper edge is at most 1/SUB above it,
+// buckets are contiguous, and the extremes land in the first and last bucket.
+template <int SUB>
+void checkHistogramBuckets() {
+    typedef runtime::Histogram<SUB> Histogram;
+    for (uint64_t v = 0; v < uint64_t(SUB); v++) CHECK(Histogram::bucketValue(Histogram::bucketOf(v)) == v);
+
+    bool bounded = true, ordered = true;
+    int previous = -1;
+    for (uint64_t v = SUB; v < 100000; v += 1 + v / 97) {
+        int b = Histogram::bucketOf(v);
+        uint64_t edge = Histogram::bucketValue(b);
+        bounded &= edge >= v && edge - v <= v / SUB;
+        ordered &= b >= previous;
+        previous = b;
+    }
+    CHECK(bounded);
+    CHECK(ordered);
+
+    bool contiguous = true;
+    for (int b = 0; b + 1 < Histogram::BUCKETS; b++)
+        contiguous &= Histogram::bucketOf(Histogram::bucketValue(b)) == b &&
+                      Histogram::bucketOf(Histogram::bucketValue(b) + 1) == b + 1;
+    CHECK(contiguous);
+    CHECK(Histogram::bucketOf(0) == 0);
+    CHECK(Histogram::bucketOf(UINT64_MAX) == Histogram::BUCKETS - 1);
+    CHECK(Histogram::bucketValue(Histogram::BUCKETS - 1) == UINT64_MAX);
+}
+
+void testHistogramBuckets() {
+    checkHistogramBuckets<2>();
+    checkHistogramBuckets<16>();
+    checkHistogramBuckets<32>();
+}
+
+void testHistogramPercentiles() {
+    runtime::Histogram<16> histogram;
+    CHECK(histogram.count() == 0 && histogram.percentile(50) == 0);
+    CHECK(histogram.snapshot().mean() == 0.0);
+
+    for (uint64_t v = 1; v <= 1000; v++) histogram.record(v);
+    runtime::Histogram<16>::Snapshot snapshot = histogram.snapshot();
+    CHECK(snapshot.total == 1000 && histogram.count() == 1000);
+    CHECK(snapshot.sum == 500500 && snapshot.mean() == 500.5);
+    uint64_t p50 = snapshot.percentile(50), p99 = snapshot.percentile(99);
+    CHECK(p50 >= 500 && p50 <= 500 + 500 / 16);
+    CHECK(p99 >= 990 && p99 <= 1000);
+    CHECK(snapshot.percentile(100) == 1000 && histogram.maximum() == 1000);
+
+    // A percentile never reports more than the largest sample, even in a wide bucket
+    runtime::Histogram<16> single;
+    single.record(1000);  // Bucket [992, 1023]
+    CHECK(single.percentile(0) == 1000 && single.percentile(50) == 1000);
+}
+
+// Lock-free recording from several threads loses no sample, while a reader
+// takes snapshots whose totals only grow.
+void testHistogramConcurrentRecord() {
+    const int THREADS = 4, SAMPLES = 100000;
+    runtime::Histogram<16> histogram;
+    std::atomic<bool> recording{true};
+    bool growing = true;
+    std::thread reader([&]() {
+        uint64_t last = 0;
+        while (recording.load()) {
+            uint64_t total = histogram.snapshot().total;
+            growing &= total >= last;
+            last = total;
+        }
+    });
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++)
+        threads.emplace_back([&histogram, t]() {
+            for (int i = 0; i < SAMPLES; i++) histogram.record(uint64_t(i % 5000 + t));
+        });
+    for (std::thread& thread : threads) thread.join();
+    recording = false;
+    reader.join();
+    CHECK(growing);
+
+    uint64_t sum = 0;
+    for (int t = 0; t < THREADS; t++)
+        for (int i = 0; i < SAMPLES; i++) sum += uint64_t(i % 5000 + t);
+    runtime::Histogram<16>::Snapshot snapshot = histogram.snapshot();
+    CHECK(snapshot.total == uint64_t(THREADS) * SAMPLES && histogram.count() == snapshot.total);
+    CHECK(snapshot.sum == sum);
+    CHECK(histogram.maximum() == uint64_t(4999 + THREADS - 1));
+}
+
+// since() keeps only the samples of the interval; merging histograms or
+// snapshots adds their samples.
+void testHistogramSinceAndMerge() {
+    runtime::Histogram<16> histogram;
+    for (int i = 0; i < 100; i++) histogram.record(10);
+    runtime::Histogram<16>::Snapshot before = histogram.snapshot();
+    for (int i = 0; i < 50; i++) histogram.record(5000);
+    runtime::Histogram<16>::Snapshot interval = histogram.snapshot().since(before);
+    CHECK(interval.total == 50 && interval.sum == 50 * 5000);
+    uint64_t p50 = interval.percentile(50);
+    CHECK(p50 >= 5000 && p50 <= 5000 + 5000 / 16);
+    CHECK(histogram.snapshot().since(histogram.snapshot()).total == 0);
+
+    runtime::Histogram<16> other;
+    for (int i = 0; i < 150; i++) other.record(1);
+    other.record(100000);
+    runtime::Histogram<16>::Snapshot merged = histogram.snapshot();
+    merged.merge(other.snapshot());
+    histogram.merge(other);
+    runtime::Histogram<16>::Snapshot snapshot = histogram.snapshot();
+    CHECK(snapshot.total == 301 && histogram.count() == 301 && histogram.maximum() == 100000);
+    CHECK(snapshot.sum == 100 * 10 + 50 * 5000 + 150 + 100000);
+    CHECK(snapshot.percentile(40) == 1 && snapshot.percentile(100) == 100000);
+    CHECK(merged.total == snapshot.total && merged.sum == snapshot.sum && merged.largest == snapshot.largest);
+    CHECK(merged.counts == snapshot.counts);
+}
+
+}  // namespace
+
+int main() {
+    testPoolRunsEveryTaskOnce();
+    testPoolStealsFromSlowWorker();
+    testPoolPerWorkerState();
+    testArenaScopeRewinds();
+    testArenaAlignment();
+    testArenaVector();
+    testTraceWritesEveryThread();
+    testHistogramBuckets();
+    testHistogramPercentiles();
+    testHistogramConcurrentRecord();
+    testHistogramSinceAndMerge();
+    if (failures) {
+        std::cerr << failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << "All runtime tests passed\n";
+    return 0;
+}